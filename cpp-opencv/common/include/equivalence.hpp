@@ -0,0 +1,68 @@
+#ifndef EQUIVALENCE_HPP
+#define EQUIVALENCE_HPP
+
+#include "reference.hpp"
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Largest differences from the reference that still count as equivalent
+struct EquivalenceTolerance
+{
+    double steering;     // Absolute steering angle
+    double centroidPx;   // Distance of the closest cone of each color, the one the steering uses
+    double maskFraction; // Fraction of mask pixels that differ
+};
+
+// Tolerances that pixel instead of contour centroids and exact HSV kernels stay within
+EquivalenceTolerance defaultEquivalenceTolerance();
+
+// Differences of one frame between an engine and the reference
+struct FrameEquivalence
+{
+    double steering;
+    double centroidPx;       // Worst color, infinity if only one of them found a cone of a color
+    int blueCountDifference; // Candidate minus reference cone count, engines that only report the
+    int yellowCountDifference; // closest cone differ here by design, so the counts are not checked
+    double maskFraction;     // -1 if the engine has no mask stage
+    bool equivalent;
+};
+
+// Runs an engine and the frozen reference side by side on the same frames, each with its own
+// steering state, and compares masks, closest centroids and steering angle
+class EquivalenceCheck
+{
+public:
+    // engineName must name an engine, see findSteeringEngine
+    EquivalenceCheck(const std::string &engineName, const SteeringConfig &config, const EquivalenceTolerance &tolerance);
+
+    FrameEquivalence check(const cv::Mat &frame);
+    // Start both over from the initial steering state, e.g. before an unrelated frame
+    void reset();
+
+    const std::string &engineName() const { return engineName_; }
+    size_t frames() const { return frames_; }
+    size_t failures() const { return failures_; }
+    // Frames, failures and the largest differences seen
+    void printSummary(std::ostream &out) const;
+
+private:
+    std::string engineName_;
+    SteeringEngine engine_;
+    MaskStage maskStage_;
+    SteeringConfig config_;
+    EquivalenceTolerance tolerance_;
+    SteeringState referenceState_;
+    SteeringState candidateState_;
+    ReferenceFrame reference_;
+    cv::Mat candidateFrame_;
+    size_t frames_;
+    size_t failures_;
+    FrameEquivalence worst_;
+};
+
+// CSV header and row of the differences of one frame
+void writeEquivalenceHeader(std::ostream &out);
+void writeEquivalenceRow(std::ostream &out, int64_t timestampUs, const std::string &engineName, const FrameEquivalence &difference);
+
+#endif
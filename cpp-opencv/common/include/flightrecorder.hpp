@@ -0,0 +1,90 @@
+#ifndef FLIGHTRECORDER_HPP
+#define FLIGHTRECORDER_HPP
+
+#include "steering.hpp"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+// One input frame with what the live loop measured for it
+struct FlightFrame
+{
+    int64_t timestampUs;
+    double steering;
+    double frameMs;
+    StageTimings timings;
+    SteeringConfig config;      // Configuration the frame was processed with
+    SteeringState stateBefore;  // State the frame was processed from, only the first one of a window is dumped
+    bool reused;                // Steered from the previous detection (see SceneCache) instead of running the engine
+    cv::Mat image;
+};
+
+// A flight recorder dump as read back from disk
+struct FlightDump
+{
+    std::string reason;
+    std::string engine;         // Name of the steering engine of the car (see findSteeringEngine)
+    SteeringState initialState; // State before the first frame
+    std::vector<FlightFrame> frames;
+};
+
+// When the flight recorder writes out its window
+struct FlightTrigger
+{
+    double latencyBudgetMs; // A frame that takes longer than this triggers a dump
+    double maxSteeringJump; // A steering change between two frames larger than this triggers a dump
+};
+
+// Keeps the last frames of the live loop with their timings in a preallocated ring. After a frame
+// exceeds the latency budget or the steering jumps, it waits until the outlier is in the middle of
+// the window and writes the window to <directory>/flight-<timestamp>-<reason>.bin on a background
+// thread, so the frame loop never waits for the disk.
+//
+// The dump is the header "CCFLIGHT", uint32 version, int32 width, height, type, uint32 frames,
+// uint32 stages, uint32 reason length, reason, uint32 engine length, engine and the state before the
+// first frame, followed by every frame oldest first as int64 timestampUs, double steering, double
+// frameMs, stages x double ms, uint8 reused, the config and the raw pixels. A state is int32 x, y of
+// the last blue and yellow centroid and, for blue and yellow, uint32 count and int32 x, y of every
+// centroid. A config is 4 x 4 double of the blue and yellow bounds, int32 offsetX, offsetY and
+// double scaleFactor.
+class FlightRecorder
+{
+public:
+    FlightRecorder(size_t capacity, const cv::Size &size, int type, const FlightTrigger &trigger, const std::string &directory,
+                   const std::string &engine);
+    ~FlightRecorder();
+    FlightRecorder(const FlightRecorder &) = delete;
+    FlightRecorder &operator=(const FlightRecorder &) = delete;
+
+    // Preallocated slot to copy the next input frame into before it is processed with config from state
+    cv::Mat &nextImage(const SteeringConfig &config, const SteeringState &state);
+    // Complete the frame of the last nextImage() call, may start a dump
+    void endFrame(int64_t timestampUs, double steering, double frameMs, const StageTimings &timings, bool reused);
+
+private:
+    void startDump();
+
+    std::vector<FlightFrame> rings_[2];
+    size_t active_;
+    size_t next_;
+    size_t count_;
+    const FlightTrigger trigger_;
+    const std::string directory_;
+    const std::string engine_;
+    double lastSteering_;
+    bool hasLastSteering_; // False until the first frame, stays true across dumps
+    // Frames still to record before the pending dump starts, -1 if none is pending
+    long pending_;
+    std::string reason_;
+    int64_t triggerTimeUs_;
+    std::thread writer_;
+    std::atomic<bool> writing_;
+};
+
+// Read a flight recorder dump, returns false if the file cannot be read or is not a dump. The class
+// tables of every frame config are precomputed.
+bool readFlightDump(const std::string &path, FlightDump &dump);
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef HOTCONFIG_HPP
+#define HOTCONFIG_HPP
+
+#include "steering.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Immutable steering configuration, including the tables precomputed from it
+struct ConfigSnapshot
+{
+    SteeringConfig config;
+    uint64_t version;
+};
+
+// Steering configuration that can be replaced while frames are processed. Writers build a new
+// snapshot, precompute its tables and swap it in through an atomic pointer; the frame thread picks
+// up the current snapshot at the start of every frame without taking a lock.
+//
+// Only one thread may call acquire(). The snapshot it got last is protected from being freed until
+// it calls acquire() again, older snapshots are freed by the writers.
+class HotConfig
+{
+public:
+    explicit HotConfig(const SteeringConfig &initial);
+    ~HotConfig();
+    HotConfig(const HotConfig &) = delete;
+    HotConfig &operator=(const HotConfig &) = delete;
+
+    // Snapshot for the next frame, wait-free
+    const ConfigSnapshot &acquire();
+    // Precompute the tables of config and make it the current snapshot
+    void publish(const SteeringConfig &config);
+    // Reload path on top of the initial configuration whenever its modification time changes,
+    // checked every interval on a background thread. A file that fails to load keeps the current one.
+    void watch(const std::string &path, std::chrono::milliseconds interval);
+    uint64_t version() const { return current_.load()->version; }
+
+private:
+    void freeRetired();
+    void poll(const std::string &path, std::chrono::milliseconds interval);
+
+    const SteeringConfig initial_;
+    std::atomic<const ConfigSnapshot *> current_;
+    std::atomic<const ConfigSnapshot *> inUse_;
+    // Serializes the writers, never taken by acquire()
+    std::mutex writeMutex_;
+    std::vector<const ConfigSnapshot *> retired_;
+    uint64_t nextVersion_;
+    std::thread watcher_;
+    std::mutex stopMutex_;
+    std::condition_variable stopCondition_;
+    bool stop_;
+};
+
+#endif
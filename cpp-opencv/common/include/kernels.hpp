@@ -0,0 +1,51 @@
+#ifndef KERNELS_HPP
+#define KERNELS_HPP
+
+#include "steering.hpp"
+#include <cstdint>
+#include <vector>
+
+// Per-channel bitmask tables of a color class table: bit i of h[value] is set if the hue value
+// lies in the box of class i, likewise for s and v. first maps the and of the three to a label.
+struct ClassTables
+{
+    uint8_t h[256];
+    uint8_t s[256];
+    uint8_t v[256];
+    uint8_t first[256];
+};
+
+// At most MAX_COLOR_CLASSES classes are used, the first matching class wins where boxes overlap
+ClassTables buildClassTables(const std::vector<ColorClass> &classes);
+
+// Build the class tables of the cone colors of config into config.classTables, so that the labels
+// engine does not rebuild them for every frame
+void precomputeTables(SteeringConfig &config);
+
+// Horizontal run [x0, x1) of row y that belongs to the region of interest
+struct PixelSpan
+{
+    int y;
+    int x0;
+    int x1;
+};
+
+// The runs of image rows not covered by createIgnoreMask, cached per thread for the last frame size
+const std::vector<PixelSpan> &cachedRegionSpans(cv::Mat &image);
+
+// Shape of the part of the frame a kernel classifies
+enum RegionShape
+{
+    REGION_FULL_FRAME, // Every pixel, the spans are not used
+    REGION_SPANS       // Only the pixels of the spans, the rest of labels is 0
+};
+
+// Classify the pixels of a color frame straight from BGR(A) into labels like labelColorClasses
+// does after convertToHsv, without the intermediate HSV image. labels gets the size of the frame.
+typedef void (*LabelKernel)(const cv::Mat &img, const ClassTables &tables, const std::vector<PixelSpan> &spans, cv::Mat &labels);
+
+// The kernel compiled for the pixel layout of the given mat type (CV_8UC3 BGR or CV_8UC4 BGRA)
+// and region shape, nullptr for other types
+LabelKernel selectLabelKernel(int matType, RegionShape shape);
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef PERFCOUNTERS_HPP
+#define PERFCOUNTERS_HPP
+
+#include "steering.hpp"
+#include <cstdint>
+#include <ostream>
+
+// Linux performance counters (perf_event_open) of the calling thread, user space only
+enum PerfCounter
+{
+    COUNTER_CYCLES,
+    COUNTER_INSTRUCTIONS,
+    COUNTER_CACHE_MISSES,
+    COUNTER_BRANCH_MISSES,
+    COUNTER_PAGE_FAULTS,
+    COUNTER_COUNT
+};
+extern const char *const COUNTER_NAMES[COUNTER_COUNT];
+
+struct CounterValues
+{
+    uint64_t value[COUNTER_COUNT];
+};
+
+// Read the counters of the calling thread, they are opened as one group on the first call of every
+// thread. Counters the CPU or a virtual machine does not offer read as 0. Returns false if no counter
+// could be opened, e.g. when /proc/sys/kernel/perf_event_paranoid is above 2.
+bool readThreadCounters(CounterValues &values);
+
+// Counter deltas of every stage of one engine call, see StageClock
+struct StageCounters
+{
+    CounterValues stage[STAGE_COUNT];
+    CounterValues last; // Values at the previous mark
+};
+
+// While alive, the engine calls of the calling thread count their stages into counters, nothing is
+// counted for nullptr. Every engine call overwrites the stages it runs and zeroes the others.
+class CountStages
+{
+public:
+    explicit CountStages(StageCounters *counters);
+    ~CountStages();
+    CountStages(const CountStages &) = delete;
+    CountStages &operator=(const CountStages &) = delete;
+
+private:
+    StageCounters *previous_;
+};
+
+// CPU time, context switches and page faults of the whole process (getrusage)
+struct ResourceUsage
+{
+    double userSeconds;
+    double systemSeconds;
+    long voluntarySwitches;
+    long involuntarySwitches;
+    long minorFaults;
+    long majorFaults;
+};
+ResourceUsage resourceUsage();
+// Usage between two calls of resourceUsage()
+ResourceUsage usageSince(const ResourceUsage &start, const ResourceUsage &end);
+
+// Sums the counters of every stage over the frames of a run
+class CounterSummary
+{
+public:
+    CounterSummary();
+
+    void addFrame(const StageCounters &counters);
+    size_t frames() const { return frames_; }
+
+    // Mean counters per frame of every stage and of the whole frame, with instructions per cycle and
+    // cache and branch misses per thousand instructions, then the resource usage of the run
+    void print(std::ostream &out, const ResourceUsage &usage) const;
+
+private:
+    double sums_[STAGE_COUNT][COUNTER_COUNT];
+    size_t frames_;
+};
+
+// CSV header and row of the per-stage counters of one frame, the row starts with timestampUs
+void writeCounterHeader(std::ostream &out);
+void writeCounterRow(std::ostream &out, int64_t timestampUs, const StageCounters &counters);
+
+#endif
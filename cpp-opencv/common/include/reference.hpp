@@ -0,0 +1,22 @@
+#ifndef REFERENCE_HPP
+#define REFERENCE_HPP
+
+#include "steering.hpp"
+#include <vector>
+
+// Everything the reference pipeline produces for one frame
+struct ReferenceFrame
+{
+    cv::Mat blueMask;   // 0/255 with the ignore mask applied
+    cv::Mat yellowMask;
+    std::vector<cv::Point> blueCentroids;
+    std::vector<cv::Point> yellowCentroids;
+    double steering;
+};
+
+// Frozen copy of the contour pipeline of processFrame (HSV conversion, thresholds, ignore mask,
+// contour centroids and steering) that faster engines are checked against. It shares no code with
+// steering.cpp on purpose, so optimizations there cannot change it. Do not optimize it.
+void runReference(const cv::Mat &img, const SteeringConfig &config, SteeringState &state, ReferenceFrame &result);
+
+#endif
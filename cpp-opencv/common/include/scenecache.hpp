@@ -0,0 +1,51 @@
+#ifndef SCENECACHE_HPP
+#define SCENECACHE_HPP
+
+#include "steering.hpp"
+#include <cstddef>
+
+// Block means of the region of interest (the rows below the top part of createIgnoreMask), from
+// cv::resize with INTER_AREA. The text main draws into the top of the frame is not part of it.
+void frameSignature(const cv::Mat &img, cv::Mat &signature);
+// Largest difference of a block of two signatures in intensity levels, infinity if they do not
+// match in size or type. Sensor noise averages out over a block, a cone that moves by a pixel does
+// not; with a mean over all blocks it would.
+double signatureDelta(const cv::Mat &a, const cv::Mat &b);
+
+// Steering of a reused frame: the detection of the last processed frame still holds, only the
+// steering is repeated from the centroids in state so that a changed configuration applies right
+// away. Only the steering stage is timed, verbose draws the overlay of the previous detection.
+double reuseDetection(cv::Mat &img, bool verbose, const SteeringConfig &config, SteeringState &state, StageTimings *timings = nullptr);
+
+// Skips the detection for frames that look like the last processed one, e.g. while the car stands
+// still. The signature of every frame is compared with the one of the last processed frame, so a
+// slow drift adds up until the frame is processed again. Reused frames steer from the previous cone
+// centroids in state, at most refreshFrames frames in a row.
+class SceneCache
+{
+public:
+    SceneCache(double threshold, int refreshFrames);
+
+    // engine(img, verbose, config, state, timings) unless the frame can be reused, then reuseDetection
+    double process(SteeringEngine engine, cv::Mat &img, bool verbose, const SteeringConfig &config, SteeringState &state,
+                   StageTimings *timings = nullptr);
+
+    // Forget the last processed frame, e.g. when the steering state is reset
+    void reset();
+
+    bool lastReused() const { return lastReused_; }
+    size_t frames() const { return frames_; }
+    size_t reusedFrames() const { return reusedFrames_; }
+
+private:
+    double threshold_;
+    int refreshFrames_;
+    cv::Mat processedSignature_; // Signature of the last processed frame
+    cv::Mat signature_;
+    int reusedInRow_;
+    bool lastReused_;
+    size_t frames_;
+    size_t reusedFrames_;
+};
+
+#endif
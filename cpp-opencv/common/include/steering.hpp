@@ -3,6 +3,10 @@
 
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
+#include "tracing.hpp"
+#include <chrono>
+#include <memory>
+#include <string>
 
 extern int OFFSET_X;
 extern int OFFSET_Y;
@@ -16,7 +20,177 @@ extern cv::Point& getLastYellowCentroid();
 void setLastBlueCentroid(const cv::Point& centroid);
 void setLastYellowCentroid(const cv::Point& centroid);
 
-extern double processFrame(cv::Mat &img, bool verbose);
+// Stages of processFrame in the order they run
+enum SteeringStage
+{
+    STAGE_HSV,
+    STAGE_THRESHOLD,
+    STAGE_IGNORE_MASK,
+    STAGE_CENTROIDS,
+    STAGE_STEERING,
+    STAGE_COUNT
+};
+extern const char *const STAGE_NAMES[STAGE_COUNT];
+
+// Wall time in milliseconds spent in each stage of one processFrame call
+struct StageTimings
+{
+    double ms[STAGE_COUNT];
+};
+
+// Performance counters of the stages, see CountStages in perfcounters.hpp
+struct StageCounters;
+StageCounters *activeStageCounters();
+void startStageCounters(StageCounters *counters);
+void markStageCounters(StageCounters *counters, SteeringStage stage);
+
+// Stores the time since the previous mark in the given stage and traces it as a span, does nothing
+// when timing is disabled and tracing is compiled out. Also counts the stage when CountStages is active.
+class StageClock
+{
+public:
+    explicit StageClock(StageTimings *timings)
+        : timings_(timings), counters_(activeStageCounters()), last_(std::chrono::steady_clock::now())
+    {
+        // The clock restarts after every counter read, so no stage's wall time includes one
+        if (counters_ != nullptr)
+        {
+            startStageCounters(counters_);
+            last_ = std::chrono::steady_clock::now();
+        }
+    }
+
+    void mark(SteeringStage stage)
+    {
+        if (timings_ != nullptr || TRACING_ENABLED)
+        {
+            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            if (timings_ != nullptr)
+            {
+                timings_->ms[stage] = std::chrono::duration<double, std::milli>(now - last_).count();
+            }
+            TRACE_SPAN(STAGE_NAMES[stage], last_, now);
+            last_ = now;
+        }
+        if (counters_ != nullptr)
+        {
+            markStageCounters(counters_, stage);
+            last_ = std::chrono::steady_clock::now();
+        }
+    }
+
+private:
+    StageTimings *timings_;
+    StageCounters *counters_;
+    std::chrono::steady_clock::time_point last_;
+};
+
+struct ClassTables;
+
+// Tunable parameters of the steering algorithm, the globals above are the defaults
+struct SteeringConfig
+{
+    cv::Scalar blueLower, blueUpper, yellowLower, yellowUpper;
+    int offsetX;
+    int offsetY;
+    double scaleFactor;
+    // Color class tables of the bounds above (see precomputeTables), nullptr builds them per frame
+    std::shared_ptr<const ClassTables> classTables;
+};
+
+// Values carried over from one frame to the next
+struct SteeringState
+{
+    cv::Point lastBlueCentroid;
+    cv::Point lastYellowCentroid;
+    // Cone centroids detected in the most recent frame
+    std::vector<cv::Point> blueCentroids;
+    std::vector<cv::Point> yellowCentroids;
+};
+
+// Points the steering angle was derived from, used to draw the overlay
+struct SteeringPath
+{
+    cv::Point blueCentroid;
+    cv::Point yellowCentroid;
+    cv::Point pathCenter;
+    std::vector<cv::Point> pathCenterPoints;
+};
+
+SteeringConfig defaultSteeringConfig();
+SteeringState initialSteeringState();
+// Read "key = value" lines (blue_lower = 81, 102, 40 / offset_x = 200 / scale_factor = 0.001 ...)
+// on top of the given config. Returns false if the file cannot be read or has an unknown key.
+bool loadSteeringConfig(const std::string &path, SteeringConfig &config);
+
+// Uses the global configuration and the global last centroids
+extern double processFrame(cv::Mat &img, bool verbose, StageTimings *timings = nullptr);
+double processFrame(cv::Mat &img, bool verbose, const SteeringConfig &config, SteeringState &state, StageTimings *timings = nullptr);
+
+// Same steering as processFrame, but only looks for the closest cone of each color: the region of
+// interest is converted and thresholded one row at a time from the bottom up, blobs are grown from
+// horizontal runs and the scan stops once no unseen blob can be closer. Centroids are pixel
+// centroids instead of contour centroids and only the closest cones end up in state. Verbose runs
+// the full pipeline because the overlay needs every cone.
+double processFrameFastPath(cv::Mat &img, bool verbose, const SteeringConfig &config, SteeringState &state, StageTimings *timings = nullptr);
+
+// Same interface as processFrame without contours: the region of interest is split into horizontal
+// bands and every band reduces its blue and yellow masks to column histograms, whose mass centers
+// stand in for the cone centroids. Costs little more than one pass over the masks.
+double processFrameHistogram(cv::Mat &img, bool verbose, const SteeringConfig &config, SteeringState &state, StageTimings *timings = nullptr);
+
+// A cone color as a box in HSV space, bounds inclusive like cv::inRange
+struct ColorClass
+{
+    std::string name;
+    cv::Scalar lower;
+    cv::Scalar upper;
+};
+// The label image holds one bit per class while classifying, so a table has at most this many classes
+const size_t MAX_COLOR_CLASSES = 8;
+
+// Blue (label 1) and yellow (label 2) from the config, further colors such as orange can be appended
+std::vector<ColorClass> coneColorClasses(const SteeringConfig &config);
+// Classify every pixel of hsvImage against all classes in one pass. labels gets 0 where no class
+// matches or ignoreMask is set, otherwise 1 + the index of the first matching class.
+void labelColorClasses(const cv::Mat &hsvImage, const std::vector<ColorClass> &classes, const cv::Mat &ignoreMask, cv::Mat &labels);
+// One connected-component pass over a label image: the centroids of the 8-connected blobs of more
+// than 50 pixels, per class (index 0 is label 1), shifted by offset
+std::vector<std::vector<cv::Point>> findClassCentroids(const cv::Mat &labels, size_t classCount, const cv::Point &offset);
+// processFrame on a label image from the class table instead of one mask and contour pass per color.
+// BGR and BGRA frames are labeled by a kernel compiled for their layout (see kernels.hpp), other
+// formats go through convertToHsv. Centroids are pixel centroids instead of contour centroids.
+double processFrameLabels(cv::Mat &img, bool verbose, const SteeringConfig &config, SteeringState &state, StageTimings *timings = nullptr);
+
+// Interchangeable steering implementations share the signature of processFrame
+typedef double (*SteeringEngine)(cv::Mat &img, bool verbose, const SteeringConfig &config, SteeringState &state, StageTimings *timings);
+// Look up an engine by name ("contour" is processFrame), nullptr if there is no such engine
+SteeringEngine findSteeringEngine(const std::string &name);
+
+// The cone masks an engine detects in, 0/255 per color over the whole frame with the ignore mask
+// applied, e.g. to compare the detection of an engine against the reference (see equivalence.hpp)
+typedef void (*MaskStage)(cv::Mat &img, const SteeringConfig &config, cv::Mat &blueMask, cv::Mat &yellowMask);
+// Masks of convertToHsv, thresholdCones and the ignore mask, used by contour, fastpath and histogram
+void thresholdMasks(cv::Mat &img, const SteeringConfig &config, cv::Mat &blueMask, cv::Mat &yellowMask);
+// Masks of the blue and yellow labels of processFrameLabels
+void labelMasks(cv::Mat &img, const SteeringConfig &config, cv::Mat &blueMask, cv::Mat &yellowMask);
+// Mask stage of an engine by name, nullptr if there is no such engine
+MaskStage findMaskStage(const std::string &name);
+
 extern cv::Mat createIgnoreMask(cv::Mat &image);
+// createIgnoreMask of the last frame size seen by the calling thread, the mask only depends on the size
+const cv::Mat &cachedIgnoreMask(cv::Mat &image);
+
+// Individual stages of processFrame, exposed so they can be benchmarked separately
+void convertToHsv(const cv::Mat &img, cv::Mat &hsvImage);
+void thresholdCones(const cv::Mat &hsvImage, cv::Mat &blueMask, cv::Mat &yellowMask, const SteeringConfig &config);
+void applyIgnoreMask(cv::Mat &blueMask, cv::Mat &yellowMask, const cv::Mat &ignoreMask);
+std::vector<cv::Point> findConeCentroids(cv::Mat &mask);
+double computeSteeringAngle(cv::Mat &img, std::vector<cv::Point> &blueCentroids, std::vector<cv::Point> &yellowCentroids,
+                            const SteeringConfig &config, SteeringState &state);
+// The steering math of computeSteeringAngle without drawing, needs only the frame size and the
+// detected centroids (which get sorted bottom to top). path is optional.
+double steerFromCentroids(const cv::Size &frameSize, std::vector<cv::Point> &blueCentroids, std::vector<cv::Point> &yellowCentroids,
+                          const SteeringConfig &config, SteeringState &state, SteeringPath *path);
 
 #endif
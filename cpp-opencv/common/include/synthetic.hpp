@@ -0,0 +1,32 @@
+#ifndef SYNTHETIC_HPP
+#define SYNTHETIC_HPP
+
+#include <opencv2/core/core.hpp>
+#include <cstdint>
+#include <vector>
+
+// Parameters for a synthetic scene of blue (left) and yellow (right) cones
+struct SyntheticScene
+{
+    int width;              // Frame width in pixels
+    int height;             // Frame height in pixels
+    int coneCount;          // Total number of cones, split evenly between both sides
+    double noise;           // Standard deviation of the gaussian pixel noise
+    uint64_t seed;          // Seed for the random number generator, same seed gives same frame
+    double coneScale;       // Cone size relative to the default size, 1 keeps the default
+    double curve;           // Sideways bend of the track at the horizon as a fraction of the width, positive bends right
+    double hueShift;        // Added to the hue of every pixel (0..180 like OpenCV), simulates a color cast
+    double saturationScale; // Multiplies the saturation of every pixel, below 1 simulates haze or glare
+    double valueShift;      // Added to the brightness of every pixel, negative simulates dusk or shadow
+};
+
+// Scene with the given size, six cones, no noise, default cone size, a straight track and neutral lighting
+SyntheticScene defaultSyntheticScene(int width, int height);
+
+// Render a BGR frame of the given scene, the result only depends on the scene parameters
+cv::Mat renderConeScene(const SyntheticScene &scene);
+
+// Same as above and also return the centroids of the drawn cones, e.g. to compute a ground truth
+cv::Mat renderConeScene(const SyntheticScene &scene, std::vector<cv::Point> &blueCones, std::vector<cv::Point> &yellowCones);
+
+#endif
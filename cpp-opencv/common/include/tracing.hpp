@@ -0,0 +1,64 @@
+#ifndef TRACING_HPP
+#define TRACING_HPP
+
+#include <chrono>
+#include <string>
+
+// Spans of the frame pipeline in the Chrome trace event format (chrome://tracing or
+// ui.perfetto.dev). Every thread appends to its own buffer, writeTrace collects them.
+//
+// Tracing is compiled in with the ENABLE_TRACING CMake option. Without it the TRACE_ macros expand
+// to nothing and TRACING_ENABLED is false, so no clock is read and nothing is stored.
+
+#ifdef ENABLE_TRACING
+const bool TRACING_ENABLED = true;
+
+// Append an event of the calling thread. name must outlive the trace (a string literal or one of
+// STAGE_NAMES), only the pointer is stored. phase is 'B' (begin), 'E' (end) or 'X' (complete span
+// from start to end).
+void traceEvent(const char *name, char phase, const std::chrono::steady_clock::time_point &start,
+                const std::chrono::steady_clock::time_point &end);
+
+// Name of the calling thread in the trace
+void traceThreadName(const std::string &name);
+
+// Span from construction to destruction
+class TraceScope
+{
+public:
+    explicit TraceScope(const char *name) : name_(name), start_(std::chrono::steady_clock::now()) {}
+    ~TraceScope() { traceEvent(name_, 'X', start_, std::chrono::steady_clock::now()); }
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+    const char *name_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+#define TRACE_BEGIN(name) traceEvent(name, 'B', std::chrono::steady_clock::now(), std::chrono::steady_clock::time_point())
+#define TRACE_END(name) traceEvent(name, 'E', std::chrono::steady_clock::now(), std::chrono::steady_clock::time_point())
+#define TRACE_SPAN(name, start, end) traceEvent(name, 'X', start, end)
+#define TRACE_THREAD_NAME(name) traceThreadName(name)
+#else
+const bool TRACING_ENABLED = false;
+
+#define TRACE_SCOPE(name)
+#define TRACE_BEGIN(name)
+#define TRACE_END(name)
+#define TRACE_SPAN(name, start, end)
+#define TRACE_THREAD_NAME(name)
+#endif
+
+// Write the events of every thread recorded so far as trace JSON. Call it once the traced threads
+// are idle, the buffers are not locked. Returns false if the file cannot be written or tracing is
+// compiled out.
+bool writeTrace(const std::string &path);
+// False with the error writeTrace would report if tracing is compiled out, so that a run asked for
+// a trace can stop before it starts
+bool checkTraceSupport(const std::string &path);
+
+#endif
@@ -0,0 +1,43 @@
+#include "steering.hpp"
+
+namespace
+{
+    struct NamedEngine
+    {
+        const char *name;
+        SteeringEngine engine;
+        MaskStage masks;
+    };
+
+    // All engines that can be selected by name, e.g. for side-by-side evaluation in performance
+    const NamedEngine ENGINES[] = {
+        {"contour", &processFrame, &thresholdMasks},
+        {"fastpath", &processFrameFastPath, &thresholdMasks},
+        {"histogram", &processFrameHistogram, &thresholdMasks},
+        {"labels", &processFrameLabels, &labelMasks},
+    };
+}
+
+SteeringEngine findSteeringEngine(const std::string &name)
+{
+    for (const NamedEngine &entry : ENGINES)
+    {
+        if (name == entry.name)
+        {
+            return entry.engine;
+        }
+    }
+    return nullptr;
+}
+
+MaskStage findMaskStage(const std::string &name)
+{
+    for (const NamedEngine &entry : ENGINES)
+    {
+        if (name == entry.name)
+        {
+            return entry.masks;
+        }
+    }
+    return nullptr;
+}
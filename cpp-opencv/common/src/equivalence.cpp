@@ -0,0 +1,100 @@
+#include "equivalence.hpp"
+#include <cmath>
+#include <limits>
+
+namespace
+{
+    // Distance of the lowest (closest) centroids, 0 if neither has one and infinity if only one has
+    double closestDistance(const std::vector<cv::Point> &reference, const std::vector<cv::Point> &candidate)
+    {
+        if (reference.empty() || candidate.empty())
+        {
+            return (reference.empty() && candidate.empty()) ? 0.0 : std::numeric_limits<double>::infinity();
+        }
+        auto lower = [](const cv::Point &a, const cv::Point &b) { return a.y > b.y; };
+        const cv::Point a = *std::min_element(reference.begin(), reference.end(), lower);
+        const cv::Point b = *std::min_element(candidate.begin(), candidate.end(), lower);
+        return std::hypot(a.x - b.x, a.y - b.y);
+    }
+
+    int differentPixels(const cv::Mat &a, const cv::Mat &b)
+    {
+        cv::Mat difference;
+        cv::absdiff(a, b, difference);
+        return cv::countNonZero(difference);
+    }
+}
+
+EquivalenceTolerance defaultEquivalenceTolerance()
+{
+    return EquivalenceTolerance{0.005, 2.0, 0.001};
+}
+
+EquivalenceCheck::EquivalenceCheck(const std::string &engineName, const SteeringConfig &config, const EquivalenceTolerance &tolerance)
+    : engineName_(engineName), engine_(findSteeringEngine(engineName)), maskStage_(findMaskStage(engineName)), config_(config),
+      tolerance_(tolerance), referenceState_(initialSteeringState()), candidateState_(initialSteeringState()),
+      reference_{cv::Mat(), cv::Mat(), {}, {}, 0}, candidateFrame_(), frames_(0), failures_(0), worst_{0, 0, 0, 0, -1, true}
+{
+}
+
+FrameEquivalence EquivalenceCheck::check(const cv::Mat &frame)
+{
+    FrameEquivalence difference{0, 0, 0, 0, -1, true};
+    runReference(frame, config_, referenceState_, reference_);
+
+    // Engines draw on their frame, so the candidate gets a copy
+    frame.copyTo(candidateFrame_);
+    const double steering = engine_(candidateFrame_, false, config_, candidateState_, nullptr);
+    difference.steering = std::fabs(steering - reference_.steering);
+    difference.centroidPx = std::max(closestDistance(reference_.blueCentroids, candidateState_.blueCentroids),
+                                     closestDistance(reference_.yellowCentroids, candidateState_.yellowCentroids));
+    difference.blueCountDifference = static_cast<int>(candidateState_.blueCentroids.size()) - static_cast<int>(reference_.blueCentroids.size());
+    difference.yellowCountDifference = static_cast<int>(candidateState_.yellowCentroids.size()) - static_cast<int>(reference_.yellowCentroids.size());
+
+    if (maskStage_ != nullptr)
+    {
+        cv::Mat blueMask, yellowMask;
+        frame.copyTo(candidateFrame_);
+        maskStage_(candidateFrame_, config_, blueMask, yellowMask);
+        difference.maskFraction = static_cast<double>(differentPixels(blueMask, reference_.blueMask) + differentPixels(yellowMask, reference_.yellowMask)) /
+                                  (2.0 * static_cast<double>(frame.total()));
+    }
+    difference.equivalent = difference.steering <= tolerance_.steering && difference.centroidPx <= tolerance_.centroidPx &&
+                            difference.maskFraction <= tolerance_.maskFraction;
+
+    frames_++;
+    failures_ += difference.equivalent ? 0 : 1;
+    worst_.steering = std::max(worst_.steering, difference.steering);
+    worst_.centroidPx = std::max(worst_.centroidPx, difference.centroidPx);
+    worst_.maskFraction = std::max(worst_.maskFraction, difference.maskFraction);
+    return difference;
+}
+
+void EquivalenceCheck::reset()
+{
+    referenceState_ = initialSteeringState();
+    candidateState_ = initialSteeringState();
+}
+
+void EquivalenceCheck::printSummary(std::ostream &out) const
+{
+    out << engineName_ << " vs reference: " << failures_ << " of " << frames_ << " frames outside the tolerance, largest differences: steering "
+        << worst_.steering << " (" << tolerance_.steering << "), closest centroid " << worst_.centroidPx << " px (" << tolerance_.centroidPx << ")";
+    if (maskStage_ != nullptr)
+    {
+        out << ", mask " << worst_.maskFraction << " (" << tolerance_.maskFraction << ")";
+    }
+    out << std::endl;
+}
+
+void writeEquivalenceHeader(std::ostream &out)
+{
+    out << "timestamp,engine,steering_diff,centroid_px,blue_count_diff,yellow_count_diff,mask_fraction,equivalent\n";
+}
+
+void writeEquivalenceRow(std::ostream &out, int64_t timestampUs, const std::string &engineName, const FrameEquivalence &difference)
+{
+    out << timestampUs << "," << engineName << "," << difference.steering << "," << difference.centroidPx << ","
+        << difference.blueCountDifference << "," << difference.yellowCountDifference << "," << difference.maskFraction << ","
+        << (difference.equivalent ? 1 : 0) << "\n";
+}
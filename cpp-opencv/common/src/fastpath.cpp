@@ -0,0 +1,243 @@
+#include "steering.hpp"
+#include <cstdint>
+
+namespace
+{
+    // Same noise filter as findConeCentroids
+    const int MIN_CONE_AREA = 50;
+
+    // Finds the cone with the lowest centroid in one color by growing blobs from horizontal runs
+    // while the rows are fed in from the bottom of the frame upwards
+    class ClosestConeScan
+    {
+    public:
+        ClosestConeScan() : blobs_(), previous_(), current_(), active_(), bestY_(-1.0), best_(-1, -1), done_(false) {}
+
+        // Add the runs of row y, a pixel belongs to a cone if it is set in mask and not in ignore
+        void addRow(const uint8_t *mask, const uint8_t *ignore, int cols, int y)
+        {
+            current_.clear();
+            size_t first = 0;
+            for (int x = 0; x < cols; x++)
+            {
+                if (mask[x] == 0 || ignore[x] != 0)
+                {
+                    continue;
+                }
+                Run run{x, x, -1};
+                while (run.x1 + 1 < cols && mask[run.x1 + 1] != 0 && ignore[run.x1 + 1] == 0)
+                {
+                    run.x1++;
+                }
+                x = run.x1;
+
+                // Join every run of the row below that touches this one, including diagonally
+                while (first < previous_.size() && previous_[first].x1 + 1 < run.x0)
+                {
+                    first++;
+                }
+                for (size_t i = first; i < previous_.size() && previous_[i].x0 <= run.x1 + 1; i++)
+                {
+                    const int blob = find(previous_[i].blob);
+                    if (run.blob == -1)
+                    {
+                        run.blob = blob;
+                    }
+                    else if (blob != run.blob)
+                    {
+                        merge(blob, run.blob);
+                    }
+                }
+                if (run.blob == -1)
+                {
+                    run.blob = static_cast<int>(blobs_.size());
+                    blobs_.push_back(Blob{run.blob, 0, 0.0, 0.0, y});
+                    active_.push_back(run.blob);
+                }
+                Blob &blob = blobs_[run.blob];
+                const int length = run.x1 - run.x0 + 1;
+                blob.count += length;
+                blob.sumX += length * (run.x0 + run.x1) / 2.0;
+                blob.sumY += static_cast<double>(length) * y;
+                blob.lastRow = y;
+                current_.push_back(run);
+            }
+            previous_.swap(current_);
+
+            // Blobs without a run in this row are complete
+            size_t kept = 0;
+            for (int id : active_)
+            {
+                if (blobs_[id].parent != id)
+                {
+                    continue;
+                }
+                if (blobs_[id].lastRow == y)
+                {
+                    active_[kept++] = id;
+                }
+                else
+                {
+                    complete(blobs_[id]);
+                }
+            }
+            active_.resize(kept);
+            done_ = closestConfirmed(y);
+        }
+
+        // Complete the blobs that reach the top of the scanned region
+        void finish()
+        {
+            for (int id : active_)
+            {
+                if (blobs_[id].parent == id)
+                {
+                    complete(blobs_[id]);
+                }
+            }
+            active_.clear();
+        }
+
+        // True once no blob above the scanned rows can have a lower centroid than the best one
+        bool done() const { return done_; }
+        bool found() const { return bestY_ >= 0; }
+        cv::Point closest() const { return best_; }
+
+    private:
+        struct Run
+        {
+            int x0;
+            int x1; // Inclusive
+            int blob;
+        };
+
+        struct Blob
+        {
+            int parent;
+            int count;
+            double sumX;
+            double sumY;
+            int lastRow;
+        };
+
+        int find(int id)
+        {
+            while (blobs_[id].parent != id)
+            {
+                blobs_[id].parent = blobs_[blobs_[id].parent].parent;
+                id = blobs_[id].parent;
+            }
+            return id;
+        }
+
+        void merge(int from, int into)
+        {
+            Blob &source = blobs_[from];
+            Blob &target = blobs_[into];
+            target.count += source.count;
+            target.sumX += source.sumX;
+            target.sumY += source.sumY;
+            source.parent = into;
+        }
+
+        void complete(const Blob &blob)
+        {
+            if (blob.count <= MIN_CONE_AREA)
+            {
+                return;
+            }
+            // Rows are added bottom up, so on equal height the first completed blob wins
+            const double y = blob.sumY / blob.count;
+            if (y > bestY_)
+            {
+                bestY_ = y;
+                best_ = cv::Point(static_cast<int>(blob.sumX / blob.count), static_cast<int>(y));
+            }
+        }
+
+        // Blobs that have not started yet lie above row y. Blobs that are still growing only add
+        // rows above their current centroid, so their centroid can only move up.
+        bool closestConfirmed(int y) const
+        {
+            if (!found() || bestY_ < y)
+            {
+                return false;
+            }
+            for (int id : active_)
+            {
+                if (blobs_[id].sumY / blobs_[id].count > bestY_)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        std::vector<Blob> blobs_;
+        std::vector<Run> previous_;
+        std::vector<Run> current_;
+        std::vector<int> active_;
+        double bestY_;
+        cv::Point best_;
+        bool done_;
+    };
+}
+
+double processFrameFastPath(cv::Mat &img, bool verbose, const SteeringConfig &config, SteeringState &state, StageTimings *timings)
+{
+    // The overlay draws the rails of every cone, which only the full pipeline finds
+    if (verbose)
+    {
+        return processFrame(img, verbose, config, state, timings);
+    }
+    TRACE_SCOPE("processFrameFastPath");
+    if (timings != nullptr)
+    {
+        *timings = StageTimings();
+    }
+    StageClock clock(timings);
+
+    const cv::Mat &ignoreMask = cachedIgnoreMask(img);
+    clock.mark(STAGE_IGNORE_MASK);
+
+    // Convert and threshold one row at a time, bottom up, until the closest cone of both colors is
+    // known. The rows above the top of the region of interest (see createIgnoreMask) are never read.
+    const int top = static_cast<int>(img.rows * 0.55);
+    ClosestConeScan blue, yellow;
+    cv::Mat hsvRow, maskRow;
+    for (int y = img.rows - 1; y >= top && !(blue.done() && yellow.done()); y--)
+    {
+        cv::cvtColor(img.row(y), hsvRow, cv::COLOR_BGR2HSV);
+        const uint8_t *ignore = ignoreMask.ptr<uint8_t>(y);
+        if (!blue.done())
+        {
+            cv::inRange(hsvRow, config.blueLower, config.blueUpper, maskRow);
+            blue.addRow(maskRow.ptr<uint8_t>(0), ignore, img.cols, y);
+        }
+        if (!yellow.done())
+        {
+            cv::inRange(hsvRow, config.yellowLower, config.yellowUpper, maskRow);
+            yellow.addRow(maskRow.ptr<uint8_t>(0), ignore, img.cols, y);
+        }
+    }
+    blue.finish();
+    yellow.finish();
+
+    // The steering only depends on the closest cone of each color, so the other cones are not reported
+    std::vector<cv::Point> blueCentroids, yellowCentroids;
+    if (blue.found())
+    {
+        blueCentroids.push_back(blue.closest());
+    }
+    if (yellow.found())
+    {
+        yellowCentroids.push_back(yellow.closest());
+    }
+    state.blueCentroids = blueCentroids;
+    state.yellowCentroids = yellowCentroids;
+    clock.mark(STAGE_CENTROIDS);
+
+    double steeringAngle = steerFromCentroids(img.size(), blueCentroids, yellowCentroids, config, state, nullptr);
+    clock.mark(STAGE_STEERING);
+    return steeringAngle;
+}
@@ -0,0 +1,304 @@
+#include "flightrecorder.hpp"
+#include "kernels.hpp"
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+    const char MAGIC[8] = {'C', 'C', 'F', 'L', 'I', 'G', 'H', 'T'};
+    const uint32_t VERSION = 2;
+
+    template <typename T>
+    void writeValue(std::ofstream &file, const T &value)
+    {
+        file.write(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    bool readValue(std::ifstream &file, T &value)
+    {
+        return static_cast<bool>(file.read(reinterpret_cast<char *>(&value), sizeof(T)));
+    }
+
+    void writeString(std::ofstream &file, const std::string &value)
+    {
+        writeValue(file, static_cast<uint32_t>(value.size()));
+        file.write(value.data(), static_cast<std::streamsize>(value.size()));
+    }
+
+    bool readString(std::ifstream &file, std::string &value)
+    {
+        uint32_t length = 0;
+        if (!readValue(file, length))
+        {
+            return false;
+        }
+        value.resize(length);
+        return length == 0 || static_cast<bool>(file.read(&value[0], length));
+    }
+
+    void writePoint(std::ofstream &file, const cv::Point &point)
+    {
+        writeValue(file, static_cast<int32_t>(point.x));
+        writeValue(file, static_cast<int32_t>(point.y));
+    }
+
+    bool readPoint(std::ifstream &file, cv::Point &point)
+    {
+        int32_t x = 0, y = 0;
+        if (!readValue(file, x) || !readValue(file, y))
+        {
+            return false;
+        }
+        point = cv::Point(x, y);
+        return true;
+    }
+
+    void writePoints(std::ofstream &file, const std::vector<cv::Point> &points)
+    {
+        writeValue(file, static_cast<uint32_t>(points.size()));
+        for (const cv::Point &point : points)
+        {
+            writePoint(file, point);
+        }
+    }
+
+    bool readPoints(std::ifstream &file, std::vector<cv::Point> &points)
+    {
+        uint32_t count = 0;
+        if (!readValue(file, count))
+        {
+            return false;
+        }
+        points.resize(count);
+        for (cv::Point &point : points)
+        {
+            if (!readPoint(file, point))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void writeState(std::ofstream &file, const SteeringState &state)
+    {
+        writePoint(file, state.lastBlueCentroid);
+        writePoint(file, state.lastYellowCentroid);
+        writePoints(file, state.blueCentroids);
+        writePoints(file, state.yellowCentroids);
+    }
+
+    bool readState(std::ifstream &file, SteeringState &state)
+    {
+        return readPoint(file, state.lastBlueCentroid) && readPoint(file, state.lastYellowCentroid) &&
+               readPoints(file, state.blueCentroids) && readPoints(file, state.yellowCentroids);
+    }
+
+    void writeConfig(std::ofstream &file, const SteeringConfig &config)
+    {
+        for (const cv::Scalar *bound : {&config.blueLower, &config.blueUpper, &config.yellowLower, &config.yellowUpper})
+        {
+            file.write(reinterpret_cast<const char *>(bound->val), sizeof(bound->val));
+        }
+        writeValue(file, static_cast<int32_t>(config.offsetX));
+        writeValue(file, static_cast<int32_t>(config.offsetY));
+        writeValue(file, config.scaleFactor);
+    }
+
+    bool readConfig(std::ifstream &file, SteeringConfig &config)
+    {
+        for (cv::Scalar *bound : {&config.blueLower, &config.blueUpper, &config.yellowLower, &config.yellowUpper})
+        {
+            if (!file.read(reinterpret_cast<char *>(bound->val), sizeof(bound->val)))
+            {
+                return false;
+            }
+        }
+        int32_t offsetX = 0, offsetY = 0;
+        if (!readValue(file, offsetX) || !readValue(file, offsetY) || !readValue(file, config.scaleFactor))
+        {
+            return false;
+        }
+        config.offsetX = offsetX;
+        config.offsetY = offsetY;
+        return true;
+    }
+
+    bool writeDump(const std::string &path, const std::vector<FlightFrame> &ring, size_t first, size_t count, const std::string &reason,
+                   const std::string &engine)
+    {
+        std::ofstream file(path, std::ios::binary);
+        if (!file.is_open())
+        {
+            return false;
+        }
+        const cv::Mat &sample = ring[first].image;
+        file.write(MAGIC, sizeof(MAGIC));
+        writeValue(file, VERSION);
+        writeValue(file, static_cast<int32_t>(sample.cols));
+        writeValue(file, static_cast<int32_t>(sample.rows));
+        writeValue(file, static_cast<int32_t>(sample.type()));
+        writeValue(file, static_cast<uint32_t>(count));
+        writeValue(file, static_cast<uint32_t>(STAGE_COUNT));
+        writeString(file, reason);
+        writeString(file, engine);
+        writeState(file, ring[first].stateBefore);
+        for (size_t i = 0; i < count; i++)
+        {
+            const FlightFrame &frame = ring[(first + i) % ring.size()];
+            writeValue(file, frame.timestampUs);
+            writeValue(file, frame.steering);
+            writeValue(file, frame.frameMs);
+            file.write(reinterpret_cast<const char *>(frame.timings.ms), sizeof(frame.timings.ms));
+            writeValue(file, static_cast<uint8_t>(frame.reused ? 1 : 0));
+            writeConfig(file, frame.config);
+            // The slots are allocated as one continuous block each
+            file.write(reinterpret_cast<const char *>(frame.image.data), static_cast<std::streamsize>(frame.image.total() * frame.image.elemSize()));
+        }
+        return static_cast<bool>(file);
+    }
+}
+
+FlightRecorder::FlightRecorder(size_t capacity, const cv::Size &size, int type, const FlightTrigger &trigger, const std::string &directory,
+                               const std::string &engine)
+    : rings_(), active_(0), next_(0), count_(0), trigger_(trigger), directory_(directory), engine_(engine), lastSteering_(0),
+      hasLastSteering_(false), pending_(-1), reason_(), triggerTimeUs_(0), writer_(), writing_(false)
+{
+    // Allocate every slot up front so that recording a frame is a plain copy
+    for (std::vector<FlightFrame> &ring : rings_)
+    {
+        for (size_t i = 0; i < std::max<size_t>(capacity, 1); i++)
+        {
+            ring.push_back(FlightFrame{0, 0, 0, StageTimings(), defaultSteeringConfig(), initialSteeringState(), false, cv::Mat(size, type)});
+        }
+    }
+}
+
+FlightRecorder::~FlightRecorder()
+{
+    if (writer_.joinable())
+    {
+        writer_.join();
+    }
+}
+
+cv::Mat &FlightRecorder::nextImage(const SteeringConfig &config, const SteeringState &state)
+{
+    FlightFrame &frame = rings_[active_][next_];
+    frame.config = config;
+    // Assigning into the slot keeps the capacity of its centroid vectors
+    frame.stateBefore = state;
+    return frame.image;
+}
+
+void FlightRecorder::endFrame(int64_t timestampUs, double steering, double frameMs, const StageTimings &timings, bool reused)
+{
+    std::vector<FlightFrame> &ring = rings_[active_];
+    FlightFrame &frame = ring[next_];
+    frame.timestampUs = timestampUs;
+    frame.steering = steering;
+    frame.frameMs = frameMs;
+    frame.timings = timings;
+    frame.reused = reused;
+    next_ = (next_ + 1) % ring.size();
+    count_ = std::min(count_ + 1, ring.size());
+
+    // A new outlier is only taken once the previous dump has been written
+    if (pending_ < 0 && !writing_.load())
+    {
+        if (frameMs > trigger_.latencyBudgetMs)
+        {
+            reason_ = "latency";
+        }
+        else if (hasLastSteering_ && std::fabs(steering - lastSteering_) > trigger_.maxSteeringJump)
+        {
+            reason_ = "steering-jump";
+        }
+        if (!reason_.empty())
+        {
+            pending_ = static_cast<long>(ring.size() / 2);
+            triggerTimeUs_ = timestampUs;
+        }
+    }
+    lastSteering_ = steering;
+    hasLastSteering_ = true;
+
+    if (pending_ == 0)
+    {
+        startDump();
+    }
+    if (pending_ > 0)
+    {
+        pending_--;
+    }
+}
+
+void FlightRecorder::startDump()
+{
+    if (writer_.joinable())
+    {
+        writer_.join();
+    }
+    const std::vector<FlightFrame> &ring = rings_[active_];
+    const size_t first = (count_ < ring.size()) ? 0 : next_;
+    const size_t count = count_;
+    const std::string path = directory_ + "/flight-" + std::to_string(triggerTimeUs_) + "-" + reason_ + ".bin";
+    const std::string reason = reason_;
+    writing_.store(true);
+    writer_ = std::thread([this, &ring, first, count, path, reason]()
+                          {
+                              if (writeDump(path, ring, first, count, reason, engine_))
+                              {
+                                  std::clog << "Flight recorder: wrote " << count << " frames around a " << reason << " outlier to " << path << std::endl;
+                              }
+                              else
+                              {
+                                  std::cerr << "Error: Could not write flight recorder dump " << path << std::endl;
+                              }
+                              writing_.store(false); });
+
+    // Keep recording into the other ring while this one is written
+    active_ ^= 1;
+    next_ = 0;
+    count_ = 0;
+    pending_ = -1;
+    reason_.clear();
+}
+
+bool readFlightDump(const std::string &path, FlightDump &dump)
+{
+    std::ifstream file(path, std::ios::binary);
+    char magic[sizeof(MAGIC)];
+    uint32_t version = 0, count = 0, stages = 0;
+    int32_t width = 0, height = 0, type = 0;
+    dump.initialState = initialSteeringState();
+    if (!file.is_open() || !file.read(magic, sizeof(magic)) || 0 != std::memcmp(magic, MAGIC, sizeof(MAGIC)) ||
+        !readValue(file, version) || version != VERSION || !readValue(file, width) || !readValue(file, height) ||
+        !readValue(file, type) || !readValue(file, count) || !readValue(file, stages) || stages != STAGE_COUNT ||
+        width <= 0 || height <= 0 || !readString(file, dump.reason) || !readString(file, dump.engine) ||
+        !readState(file, dump.initialState))
+    {
+        return false;
+    }
+    dump.frames.clear();
+    for (uint32_t i = 0; i < count; i++)
+    {
+        FlightFrame frame{0, 0, 0, StageTimings(), defaultSteeringConfig(), initialSteeringState(), false, cv::Mat(height, width, type)};
+        uint8_t reused = 0;
+        if (!readValue(file, frame.timestampUs) || !readValue(file, frame.steering) || !readValue(file, frame.frameMs) ||
+            !file.read(reinterpret_cast<char *>(frame.timings.ms), sizeof(frame.timings.ms)) || !readValue(file, reused) ||
+            !readConfig(file, frame.config) ||
+            !file.read(reinterpret_cast<char *>(frame.image.data), static_cast<std::streamsize>(frame.image.total() * frame.image.elemSize())))
+        {
+            return false;
+        }
+        frame.reused = reused != 0;
+        // Like HotConfig does for the car, so the replay does not build the tables in every frame
+        precomputeTables(frame.config);
+        dump.frames.push_back(frame);
+    }
+    return true;
+}
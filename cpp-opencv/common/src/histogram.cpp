@@ -0,0 +1,105 @@
+#include "steering.hpp"
+
+namespace
+{
+    // The region of interest is split into this many horizontal bands. Every band yields at most
+    // one boundary point per color, so the lowest band with both colors plays the part of the
+    // closest cone pair in processFrame.
+    const int HISTOGRAM_BANDS = 6;
+    // Same noise filter as findConeCentroids, in pixels per band
+    const int MIN_BAND_PIXELS = 50;
+
+    // Column of the mass center of a band of a 0/255 mask, from its column histogram. The row is
+    // the middle of the band, the steering only uses the column. Returns false if there are too
+    // few pixels to be a cone.
+    bool bandBoundary(const cv::Mat &band, int centerY, cv::Point &boundary)
+    {
+        cv::Mat columns;
+        cv::reduce(band, columns, 0, cv::REDUCE_SUM, CV_32S);
+        const int32_t *counts = columns.ptr<int32_t>(0);
+        int64_t total = 0, weighted = 0;
+        for (int x = 0; x < columns.cols; x++)
+        {
+            total += counts[x];
+            weighted += static_cast<int64_t>(counts[x]) * x;
+        }
+        if (total / 255 <= MIN_BAND_PIXELS)
+        {
+            return false;
+        }
+        boundary = cv::Point(static_cast<int>(weighted / total), centerY);
+        return true;
+    }
+}
+
+double processFrameHistogram(cv::Mat &img, bool verbose, const SteeringConfig &config, SteeringState &state, StageTimings *timings)
+{
+    TRACE_SCOPE("processFrameHistogram");
+    if (timings != nullptr)
+    {
+        *timings = StageTimings();
+    }
+    StageClock clock(timings);
+
+    // Only the rows below the top part of createIgnoreMask are converted and thresholded
+    const int top = static_cast<int>(img.rows * 0.55);
+    const cv::Rect roi(0, top, img.cols, img.rows - top);
+    cv::Mat hsvImage;
+    convertToHsv(img(roi), hsvImage);
+    clock.mark(STAGE_HSV);
+
+    cv::Mat blueMask, yellowMask;
+    thresholdCones(hsvImage, blueMask, yellowMask, config);
+    clock.mark(STAGE_THRESHOLD);
+
+    applyIgnoreMask(blueMask, yellowMask, cachedIgnoreMask(img)(roi));
+    clock.mark(STAGE_IGNORE_MASK);
+
+    // One column histogram per band and color instead of contours
+    std::vector<cv::Point> blueCentroids, yellowCentroids;
+    for (int band = 0; band < HISTOGRAM_BANDS; band++)
+    {
+        const int start = roi.height * band / HISTOGRAM_BANDS;
+        const int end = roi.height * (band + 1) / HISTOGRAM_BANDS;
+        if (end <= start)
+        {
+            continue;
+        }
+        const int centerY = top + (start + end) / 2;
+        cv::Point boundary;
+        if (bandBoundary(blueMask.rowRange(start, end), centerY, boundary))
+        {
+            blueCentroids.push_back(boundary);
+        }
+        if (bandBoundary(yellowMask.rowRange(start, end), centerY, boundary))
+        {
+            yellowCentroids.push_back(boundary);
+        }
+    }
+    state.blueCentroids = blueCentroids;
+    state.yellowCentroids = yellowCentroids;
+    clock.mark(STAGE_CENTROIDS);
+
+    double steeringAngle;
+    if (verbose)
+    {
+        for (const cv::Point &boundary : blueCentroids)
+        {
+            cv::circle(img, boundary, 5, cv::Scalar(255, 0, 0), -1);
+        }
+        for (const cv::Point &boundary : yellowCentroids)
+        {
+            cv::circle(img, boundary, 5, cv::Scalar(0, 255, 255), -1);
+        }
+        steeringAngle = computeSteeringAngle(img, blueCentroids, yellowCentroids, config, state);
+        cv::imshow("Processed Frame", img);
+        cv::imshow("Blue Mask", blueMask);
+        cv::imshow("Yellow Mask", yellowMask);
+    }
+    else
+    {
+        steeringAngle = steerFromCentroids(img.size(), blueCentroids, yellowCentroids, config, state, nullptr);
+    }
+    clock.mark(STAGE_STEERING);
+    return steeringAngle;
+}
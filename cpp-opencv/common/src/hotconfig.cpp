@@ -0,0 +1,125 @@
+#include "hotconfig.hpp"
+#include "kernels.hpp"
+#include <iostream>
+#include <sys/stat.h>
+
+namespace
+{
+    // Modification time in nanoseconds, 0 if the file does not exist
+    int64_t modificationTime(const std::string &path)
+    {
+        struct stat info;
+        if (0 != stat(path.c_str(), &info))
+        {
+            return 0;
+        }
+        return static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+    }
+
+    const ConfigSnapshot *makeSnapshot(const SteeringConfig &config, uint64_t version)
+    {
+        ConfigSnapshot *snapshot = new ConfigSnapshot{config, version};
+        precomputeTables(snapshot->config);
+        return snapshot;
+    }
+}
+
+HotConfig::HotConfig(const SteeringConfig &initial)
+    : initial_(initial), current_(makeSnapshot(initial, 0)), inUse_(nullptr), writeMutex_(), retired_(),
+      nextVersion_(1), watcher_(), stopMutex_(), stopCondition_(), stop_(false)
+{
+}
+
+HotConfig::~HotConfig()
+{
+    if (watcher_.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(stopMutex_);
+            stop_ = true;
+        }
+        stopCondition_.notify_all();
+        watcher_.join();
+    }
+    for (const ConfigSnapshot *snapshot : retired_)
+    {
+        delete snapshot;
+    }
+    delete current_.load();
+}
+
+const ConfigSnapshot &HotConfig::acquire()
+{
+    // Announce the snapshot before using it and check that it was not replaced in between, a
+    // writer that swapped it out afterwards sees the announcement and keeps it alive
+    const ConfigSnapshot *snapshot = current_.load();
+    while (true)
+    {
+        inUse_.store(snapshot);
+        const ConfigSnapshot *latest = current_.load();
+        if (latest == snapshot)
+        {
+            return *snapshot;
+        }
+        snapshot = latest;
+    }
+}
+
+void HotConfig::publish(const SteeringConfig &config)
+{
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    // Everything the frame thread needs is built here, before the swap
+    const ConfigSnapshot *snapshot = makeSnapshot(config, nextVersion_++);
+    retired_.push_back(current_.exchange(snapshot));
+    freeRetired();
+}
+
+void HotConfig::freeRetired()
+{
+    const ConfigSnapshot *used = inUse_.load();
+    size_t kept = 0;
+    for (const ConfigSnapshot *snapshot : retired_)
+    {
+        if (snapshot == used)
+        {
+            retired_[kept++] = snapshot;
+        }
+        else
+        {
+            delete snapshot;
+        }
+    }
+    retired_.resize(kept);
+}
+
+void HotConfig::watch(const std::string &path, std::chrono::milliseconds interval)
+{
+    if (!watcher_.joinable())
+    {
+        watcher_ = std::thread(&HotConfig::poll, this, path, interval);
+    }
+}
+
+void HotConfig::poll(const std::string &path, std::chrono::milliseconds interval)
+{
+    int64_t loadedTime = modificationTime(path);
+    std::unique_lock<std::mutex> lock(stopMutex_);
+    while (!stopCondition_.wait_for(lock, interval, [this]
+                                    { return stop_; }))
+    {
+        const int64_t time = modificationTime(path);
+        if (time == loadedTime || time == 0)
+        {
+            continue;
+        }
+        loadedTime = time;
+        SteeringConfig config = initial_;
+        if (!loadSteeringConfig(path, config))
+        {
+            std::cerr << "Error: Could not reload steering configuration " << path << ", keeping the current one" << std::endl;
+            continue;
+        }
+        publish(config);
+        std::clog << "Reloaded steering configuration " << path << " (version " << version() << ")" << std::endl;
+    }
+}
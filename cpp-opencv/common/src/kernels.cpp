@@ -0,0 +1,184 @@
+#include "kernels.hpp"
+
+namespace
+{
+    // Fixed point precision of OpenCV's 8 bit BGR to HSV conversion
+    const int HSV_SHIFT = 12;
+
+    // Division tables of OpenCV's 8 bit BGR to HSV conversion, so the kernels produce exactly the
+    // hue, saturation and value of cv::cvtColor
+    struct HsvTables
+    {
+        HsvTables() : sdiv(), hdiv()
+        {
+            for (int i = 1; i < 256; i++)
+            {
+                sdiv[i] = cvRound((255 << HSV_SHIFT) / static_cast<double>(i));
+                hdiv[i] = cvRound((180 << HSV_SHIFT) / (6.0 * i));
+            }
+        }
+
+        int sdiv[256];
+        int hdiv[256];
+    };
+    const HsvTables HSV_TABLES;
+
+    // Interleaved 8 bit pixel with Channels bytes per pixel and blue at BlueIndex, red at the other end
+    template <int Channels, int BlueIndex>
+    struct PixelLayout
+    {
+        static const int channels = Channels;
+        static const int blue = BlueIndex;
+        static const int red = 2 - BlueIndex;
+    };
+    typedef PixelLayout<3, 0> Bgr;
+    typedef PixelLayout<4, 0> Bgra;
+
+    // Label of one pixel. The hue sector is chosen with masks like OpenCV does instead of branches,
+    // the alpha channel of 4 channel layouts is never read.
+    template <class Layout>
+    inline uint8_t classify(const uint8_t *pixel, const ClassTables &tables)
+    {
+        const int b = pixel[Layout::blue];
+        const int g = pixel[1];
+        const int r = pixel[Layout::red];
+        const int v = std::max(std::max(b, g), r);
+        const int diff = v - std::min(std::min(b, g), r);
+        const int vr = (v == r) ? -1 : 0;
+        const int vg = (v == g) ? -1 : 0;
+        const int s = (diff * HSV_TABLES.sdiv[v] + (1 << (HSV_SHIFT - 1))) >> HSV_SHIFT;
+        int h = (vr & (g - b)) + (~vr & ((vg & (b - r + 2 * diff)) + (~vg & (r - g + 4 * diff))));
+        h = (h * HSV_TABLES.hdiv[diff] + (1 << (HSV_SHIFT - 1))) >> HSV_SHIFT;
+        h += (h < 0) ? 180 : 0;
+        return tables.first[tables.h[h] & tables.s[s] & tables.v[v]];
+    }
+
+    // Every pixel of the frame
+    struct FullFrame
+    {
+        template <class Layout>
+        static void run(const cv::Mat &img, const ClassTables &tables, const std::vector<PixelSpan> &, cv::Mat &labels)
+        {
+            for (int y = 0; y < img.rows; y++)
+            {
+                const uint8_t *src = img.ptr<uint8_t>(y);
+                uint8_t *dst = labels.ptr<uint8_t>(y);
+                for (int x = 0; x < img.cols; x++)
+                {
+                    dst[x] = classify<Layout>(src + x * Layout::channels, tables);
+                }
+            }
+        }
+    };
+
+    // Only the pixels of the region of interest, the rest stays unlabeled
+    struct Spans
+    {
+        template <class Layout>
+        static void run(const cv::Mat &img, const ClassTables &tables, const std::vector<PixelSpan> &spans, cv::Mat &labels)
+        {
+            labels.setTo(cv::Scalar(0));
+            for (const PixelSpan &span : spans)
+            {
+                const uint8_t *src = img.ptr<uint8_t>(span.y);
+                uint8_t *dst = labels.ptr<uint8_t>(span.y);
+                for (int x = span.x0; x < span.x1; x++)
+                {
+                    dst[x] = classify<Layout>(src + x * Layout::channels, tables);
+                }
+            }
+        }
+    };
+
+    template <class Layout, class Shape>
+    void labelKernel(const cv::Mat &img, const ClassTables &tables, const std::vector<PixelSpan> &spans, cv::Mat &labels)
+    {
+        labels.create(img.size(), CV_8UC1);
+        Shape::template run<Layout>(img, tables, spans, labels);
+    }
+}
+
+ClassTables buildClassTables(const std::vector<ColorClass> &classes)
+{
+    ClassTables tables = ClassTables();
+    const size_t classCount = std::min(classes.size(), MAX_COLOR_CLASSES);
+    for (size_t i = 0; i < classCount; i++)
+    {
+        const uint8_t bit = static_cast<uint8_t>(1u << i);
+        for (int value = 0; value < 256; value++)
+        {
+            if (value >= classes[i].lower[0] && value <= classes[i].upper[0])
+            {
+                tables.h[value] |= bit;
+            }
+            if (value >= classes[i].lower[1] && value <= classes[i].upper[1])
+            {
+                tables.s[value] |= bit;
+            }
+            if (value >= classes[i].lower[2] && value <= classes[i].upper[2])
+            {
+                tables.v[value] |= bit;
+            }
+        }
+    }
+    // Label of the lowest set bit
+    for (int bits = 1; bits < 256; bits++)
+    {
+        uint8_t label = 1;
+        while ((bits & (1 << (label - 1))) == 0)
+        {
+            label++;
+        }
+        tables.first[bits] = label;
+    }
+    return tables;
+}
+
+void precomputeTables(SteeringConfig &config)
+{
+    config.classTables = std::make_shared<const ClassTables>(buildClassTables(coneColorClasses(config)));
+}
+
+const std::vector<PixelSpan> &cachedRegionSpans(cv::Mat &image)
+{
+    thread_local cv::Size size;
+    thread_local std::vector<PixelSpan> spans;
+    if (size != image.size())
+    {
+        const cv::Mat &ignoreMask = cachedIgnoreMask(image);
+        spans.clear();
+        for (int y = 0; y < ignoreMask.rows; y++)
+        {
+            const uint8_t *row = ignoreMask.ptr<uint8_t>(y);
+            for (int x = 0; x < ignoreMask.cols; x++)
+            {
+                if (row[x] != 0)
+                {
+                    continue;
+                }
+                PixelSpan span{y, x, x + 1};
+                while (span.x1 < ignoreMask.cols && row[span.x1] == 0)
+                {
+                    span.x1++;
+                }
+                spans.push_back(span);
+                x = span.x1;
+            }
+        }
+        size = image.size();
+    }
+    return spans;
+}
+
+LabelKernel selectLabelKernel(int matType, RegionShape shape)
+{
+    switch (matType)
+    {
+    case CV_8UC3:
+        return (shape == REGION_SPANS) ? &labelKernel<Bgr, Spans> : &labelKernel<Bgr, FullFrame>;
+    case CV_8UC4:
+        return (shape == REGION_SPANS) ? &labelKernel<Bgra, Spans> : &labelKernel<Bgra, FullFrame>;
+    default:
+        return nullptr;
+    }
+}
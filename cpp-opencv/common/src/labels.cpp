@@ -0,0 +1,234 @@
+#include "kernels.hpp"
+#include <cstdint>
+
+namespace
+{
+    // Same noise filter as findConeCentroids
+    const int MIN_CONE_AREA = 50;
+
+    // Pixels of one label in one row, x1 is inclusive
+    struct Run
+    {
+        int x0;
+        int x1;
+        uint8_t label;
+        int blob;
+    };
+
+    struct Blob
+    {
+        int parent;
+        uint8_t label;
+        int count;
+        double sumX;
+        double sumY;
+    };
+
+    int findRoot(std::vector<Blob> &blobs, int id)
+    {
+        while (blobs[id].parent != id)
+        {
+            blobs[id].parent = blobs[blobs[id].parent].parent;
+            id = blobs[id].parent;
+        }
+        return id;
+    }
+}
+
+std::vector<ColorClass> coneColorClasses(const SteeringConfig &config)
+{
+    return std::vector<ColorClass>{
+        ColorClass{"blue", config.blueLower, config.blueUpper},
+        ColorClass{"yellow", config.yellowLower, config.yellowUpper}};
+}
+
+void labelColorClasses(const cv::Mat &hsvImage, const std::vector<ColorClass> &classes, const cv::Mat &ignoreMask, cv::Mat &labels)
+{
+    const ClassTables tables = buildClassTables(classes);
+    labels.create(hsvImage.size(), CV_8UC1);
+    for (int y = 0; y < hsvImage.rows; y++)
+    {
+        const uint8_t *hsv = hsvImage.ptr<uint8_t>(y);
+        const uint8_t *ignore = ignoreMask.ptr<uint8_t>(y);
+        uint8_t *label = labels.ptr<uint8_t>(y);
+        for (int x = 0; x < hsvImage.cols; x++)
+        {
+            // The ignore mask is 0 or 255, so it clears every class bit where it is set
+            label[x] = tables.first[tables.h[hsv[3 * x]] & tables.s[hsv[3 * x + 1]] & tables.v[hsv[3 * x + 2]] & ~ignore[x] & 0xFF];
+        }
+    }
+}
+
+std::vector<std::vector<cv::Point>> findClassCentroids(const cv::Mat &labels, size_t classCount, const cv::Point &offset)
+{
+    // Grow 8-connected blobs of equal labels from the runs of every row with a union-find
+    std::vector<Blob> blobs;
+    std::vector<Run> previous, current;
+    for (int y = 0; y < labels.rows; y++)
+    {
+        const uint8_t *row = labels.ptr<uint8_t>(y);
+        current.clear();
+        size_t first = 0;
+        for (int x = 0; x < labels.cols; x++)
+        {
+            if (row[x] == 0)
+            {
+                continue;
+            }
+            Run run{x, x, row[x], -1};
+            while (run.x1 + 1 < labels.cols && row[run.x1 + 1] == run.label)
+            {
+                run.x1++;
+            }
+            x = run.x1;
+
+            while (first < previous.size() && previous[first].x1 + 1 < run.x0)
+            {
+                first++;
+            }
+            for (size_t i = first; i < previous.size() && previous[i].x0 <= run.x1 + 1; i++)
+            {
+                if (previous[i].label != run.label)
+                {
+                    continue;
+                }
+                const int blob = findRoot(blobs, previous[i].blob);
+                if (run.blob == -1)
+                {
+                    run.blob = blob;
+                }
+                else if (blob != run.blob)
+                {
+                    blobs[run.blob].count += blobs[blob].count;
+                    blobs[run.blob].sumX += blobs[blob].sumX;
+                    blobs[run.blob].sumY += blobs[blob].sumY;
+                    blobs[blob].parent = run.blob;
+                }
+            }
+            if (run.blob == -1)
+            {
+                run.blob = static_cast<int>(blobs.size());
+                blobs.push_back(Blob{run.blob, run.label, 0, 0.0, 0.0});
+            }
+            const int length = run.x1 - run.x0 + 1;
+            blobs[run.blob].count += length;
+            blobs[run.blob].sumX += length * (run.x0 + run.x1) / 2.0;
+            blobs[run.blob].sumY += static_cast<double>(length) * y;
+            current.push_back(run);
+        }
+        previous.swap(current);
+    }
+
+    std::vector<std::vector<cv::Point>> centroids(classCount);
+    for (size_t id = 0; id < blobs.size(); id++)
+    {
+        const Blob &blob = blobs[id];
+        if (blob.parent == static_cast<int>(id) && blob.count > MIN_CONE_AREA && blob.label <= classCount)
+        {
+            centroids[blob.label - 1].push_back(offset + cv::Point(static_cast<int>(blob.sumX / blob.count),
+                                                                   static_cast<int>(blob.sumY / blob.count)));
+        }
+    }
+    return centroids;
+}
+
+void labelMasks(cv::Mat &img, const SteeringConfig &config, cv::Mat &blueMask, cv::Mat &yellowMask)
+{
+    const std::vector<ColorClass> classes = coneColorClasses(config);
+    const LabelKernel kernel = selectLabelKernel(img.type(), REGION_SPANS);
+    cv::Mat labels;
+    if (kernel != nullptr)
+    {
+        kernel(img, (config.classTables != nullptr) ? *config.classTables : buildClassTables(classes), cachedRegionSpans(img), labels);
+    }
+    else
+    {
+        cv::Mat hsvImage;
+        convertToHsv(img, hsvImage);
+        labelColorClasses(hsvImage, classes, cachedIgnoreMask(img), labels);
+    }
+    // Labels are 1 + the class index, blue is the first class
+    cv::compare(labels, cv::Scalar(1), blueMask, cv::CMP_EQ);
+    cv::compare(labels, cv::Scalar(2), yellowMask, cv::CMP_EQ);
+}
+
+double processFrameLabels(cv::Mat &img, bool verbose, const SteeringConfig &config, SteeringState &state, StageTimings *timings)
+{
+    TRACE_SCOPE("processFrameLabels");
+    if (timings != nullptr)
+    {
+        *timings = StageTimings();
+    }
+    StageClock clock(timings);
+
+    // Only the rows below the top part of createIgnoreMask are labeled
+    const int top = static_cast<int>(img.rows * 0.55);
+    const cv::Rect roi(0, top, img.cols, img.rows - top);
+    const std::vector<ColorClass> classes = coneColorClasses(config);
+
+    // The kernel for the pixel layout of the frame is picked when the first frame of a format arrives
+    thread_local int kernelType = -1;
+    thread_local LabelKernel kernel = nullptr;
+    if (img.type() != kernelType)
+    {
+        kernel = selectLabelKernel(img.type(), REGION_SPANS);
+        kernelType = img.type();
+    }
+    cv::Mat labels;
+    if (kernel != nullptr)
+    {
+        // Conversion, thresholding and the ignore mask in one pass over the region of interest
+        if (config.classTables != nullptr)
+        {
+            kernel(img, *config.classTables, cachedRegionSpans(img), labels);
+        }
+        else
+        {
+            kernel(img, buildClassTables(classes), cachedRegionSpans(img), labels);
+        }
+        labels = labels(roi);
+        clock.mark(STAGE_THRESHOLD);
+    }
+    else
+    {
+        cv::Mat hsvImage;
+        convertToHsv(img(roi), hsvImage);
+        clock.mark(STAGE_HSV);
+
+        // Thresholding and the ignore mask are one pass that writes a single label image
+        labelColorClasses(hsvImage, classes, cachedIgnoreMask(img)(roi), labels);
+        clock.mark(STAGE_THRESHOLD);
+    }
+
+    std::vector<std::vector<cv::Point>> centroids = findClassCentroids(labels, classes.size(), cv::Point(0, top));
+    std::vector<cv::Point> &blueCentroids = centroids[0];
+    std::vector<cv::Point> &yellowCentroids = centroids[1];
+    state.blueCentroids = blueCentroids;
+    state.yellowCentroids = yellowCentroids;
+    clock.mark(STAGE_CENTROIDS);
+
+    double steeringAngle;
+    if (verbose)
+    {
+        for (const cv::Point &centroid : blueCentroids)
+        {
+            cv::circle(img, centroid, 5, cv::Scalar(255, 0, 0), -1);
+        }
+        for (const cv::Point &centroid : yellowCentroids)
+        {
+            cv::circle(img, centroid, 5, cv::Scalar(0, 255, 255), -1);
+        }
+        steeringAngle = computeSteeringAngle(img, blueCentroids, yellowCentroids, config, state);
+        cv::imshow("Processed Frame", img);
+        // Spread the labels over the gray range so that every class is visible
+        cv::Mat display;
+        labels.convertTo(display, CV_8U, 255.0 / classes.size());
+        cv::imshow("Labels", display);
+    }
+    else
+    {
+        steeringAngle = steerFromCentroids(img.size(), blueCentroids, yellowCentroids, config, state, nullptr);
+    }
+    clock.mark(STAGE_STEERING);
+    return steeringAngle;
+}
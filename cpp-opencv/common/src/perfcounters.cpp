@@ -0,0 +1,247 @@
+#include "perfcounters.hpp"
+#include <linux/perf_event.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+const char *const COUNTER_NAMES[COUNTER_COUNT] = {"cycles", "instructions", "cache_misses", "branch_misses", "page_faults"};
+
+namespace
+{
+    struct CounterEvent
+    {
+        uint32_t type;
+        uint64_t config;
+    };
+    const CounterEvent COUNTER_EVENTS[COUNTER_COUNT] = {
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS}};
+
+    // The counters of one thread as a group, so one read returns all of them for the same interval
+    class ThreadCounters
+    {
+    public:
+        ThreadCounters() : fds_(), counters_(), count_(0)
+        {
+            for (int counter = 0; counter < COUNTER_COUNT; counter++)
+            {
+                perf_event_attr attr;
+                std::memset(&attr, 0, sizeof(attr));
+                attr.size = sizeof(attr);
+                attr.type = COUNTER_EVENTS[counter].type;
+                attr.config = COUNTER_EVENTS[counter].config;
+                attr.read_format = PERF_FORMAT_GROUP;
+                attr.exclude_kernel = 1;
+                attr.exclude_hv = 1;
+                // This thread on any CPU, joined to the group of the first counter that opened
+                const int fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, (count_ == 0) ? -1 : fds_[0], 0));
+                if (fd >= 0)
+                {
+                    fds_[count_] = fd;
+                    counters_[count_++] = counter;
+                }
+            }
+        }
+
+        ~ThreadCounters()
+        {
+            for (size_t i = count_; i > 0; i--)
+            {
+                close(fds_[i - 1]);
+            }
+        }
+
+        ThreadCounters(const ThreadCounters &) = delete;
+        ThreadCounters &operator=(const ThreadCounters &) = delete;
+
+        bool read(CounterValues &values) const
+        {
+            values = CounterValues();
+            if (count_ == 0)
+            {
+                return false;
+            }
+            // Group read format: number of counters, then their values in the order they joined
+            uint64_t buffer[1 + COUNTER_COUNT];
+            if (::read(fds_[0], buffer, sizeof(buffer)) < static_cast<ssize_t>((1 + count_) * sizeof(uint64_t)))
+            {
+                return false;
+            }
+            for (size_t i = 0; i < count_; i++)
+            {
+                values.value[counters_[i]] = buffer[1 + i];
+            }
+            return true;
+        }
+
+    private:
+        int fds_[COUNTER_COUNT];
+        int counters_[COUNTER_COUNT];
+        size_t count_;
+    };
+
+    thread_local StageCounters *activeCounters = nullptr;
+
+    CounterValues difference(const CounterValues &end, const CounterValues &start)
+    {
+        CounterValues delta = CounterValues();
+        for (int counter = 0; counter < COUNTER_COUNT; counter++)
+        {
+            delta.value[counter] = end.value[counter] - start.value[counter];
+        }
+        return delta;
+    }
+
+    double seconds(const timeval &time)
+    {
+        return static_cast<double>(time.tv_sec) + static_cast<double>(time.tv_usec) / 1e6;
+    }
+}
+
+bool readThreadCounters(CounterValues &values)
+{
+    thread_local ThreadCounters counters;
+    thread_local bool reported = false;
+    if (!counters.read(values))
+    {
+        if (!reported)
+        {
+            std::cerr << "Error: Could not open performance counters, check /proc/sys/kernel/perf_event_paranoid" << std::endl;
+            reported = true;
+        }
+        return false;
+    }
+    return true;
+}
+
+StageCounters *activeStageCounters()
+{
+    return activeCounters;
+}
+
+void startStageCounters(StageCounters *counters)
+{
+    for (CounterValues &stage : counters->stage)
+    {
+        stage = CounterValues();
+    }
+    readThreadCounters(counters->last);
+}
+
+void markStageCounters(StageCounters *counters, SteeringStage stage)
+{
+    CounterValues now;
+    readThreadCounters(now);
+    counters->stage[stage] = difference(now, counters->last);
+    counters->last = now;
+}
+
+CountStages::CountStages(StageCounters *counters) : previous_(activeCounters)
+{
+    activeCounters = counters;
+}
+
+CountStages::~CountStages()
+{
+    activeCounters = previous_;
+}
+
+ResourceUsage resourceUsage()
+{
+    rusage usage;
+    std::memset(&usage, 0, sizeof(usage));
+    getrusage(RUSAGE_SELF, &usage);
+    return ResourceUsage{seconds(usage.ru_utime), seconds(usage.ru_stime), usage.ru_nvcsw, usage.ru_nivcsw, usage.ru_minflt, usage.ru_majflt};
+}
+
+ResourceUsage usageSince(const ResourceUsage &start, const ResourceUsage &end)
+{
+    return ResourceUsage{end.userSeconds - start.userSeconds, end.systemSeconds - start.systemSeconds,
+                         end.voluntarySwitches - start.voluntarySwitches, end.involuntarySwitches - start.involuntarySwitches,
+                         end.minorFaults - start.minorFaults, end.majorFaults - start.majorFaults};
+}
+
+CounterSummary::CounterSummary() : sums_(), frames_(0) {}
+
+void CounterSummary::addFrame(const StageCounters &counters)
+{
+    for (int stage = 0; stage < STAGE_COUNT; stage++)
+    {
+        for (int counter = 0; counter < COUNTER_COUNT; counter++)
+        {
+            sums_[stage][counter] += static_cast<double>(counters.stage[stage].value[counter]);
+        }
+    }
+    frames_++;
+}
+
+void CounterSummary::print(std::ostream &out, const ResourceUsage &usage) const
+{
+    out << "Performance counters per frame (mean of " << frames_ << " frames):" << std::endl;
+    out << std::left << std::setw(16) << "stage" << std::right;
+    for (const char *name : COUNTER_NAMES)
+    {
+        out << std::setw(15) << name;
+    }
+    out << std::setw(8) << "ipc" << std::setw(10) << "cm/kinst" << std::setw(10) << "bm/kinst" << std::endl;
+
+    double total[COUNTER_COUNT] = {};
+    for (int row = 0; row <= STAGE_COUNT; row++)
+    {
+        const double *sums = total;
+        if (row < STAGE_COUNT)
+        {
+            sums = sums_[row];
+            for (int counter = 0; counter < COUNTER_COUNT; counter++)
+            {
+                total[counter] += sums_[row][counter];
+            }
+        }
+        const double frames = static_cast<double>(frames_ == 0 ? 1 : frames_);
+        const double instructions = sums[COUNTER_INSTRUCTIONS];
+        const double cycles = sums[COUNTER_CYCLES];
+        out << std::left << std::setw(16) << ((row < STAGE_COUNT) ? STAGE_NAMES[row] : "frame") << std::right << std::fixed << std::setprecision(0);
+        for (int counter = 0; counter < COUNTER_COUNT; counter++)
+        {
+            out << std::setw(15) << sums[counter] / frames;
+        }
+        out << std::setprecision(2) << std::setw(8) << ((cycles > 0) ? instructions / cycles : 0.0)
+            << std::setw(10) << ((instructions > 0) ? 1000.0 * sums[COUNTER_CACHE_MISSES] / instructions : 0.0)
+            << std::setw(10) << ((instructions > 0) ? 1000.0 * sums[COUNTER_BRANCH_MISSES] / instructions : 0.0) << std::endl;
+    }
+    out << std::setprecision(3) << "Process: " << usage.userSeconds << " s user, " << usage.systemSeconds << " s system CPU time, "
+        << usage.voluntarySwitches << " voluntary and " << usage.involuntarySwitches << " involuntary context switches, "
+        << usage.minorFaults << " minor and " << usage.majorFaults << " major page faults" << std::endl;
+}
+
+void writeCounterHeader(std::ostream &out)
+{
+    out << "timestamp";
+    for (const char *stage : STAGE_NAMES)
+    {
+        for (const char *counter : COUNTER_NAMES)
+        {
+            out << "," << stage << "." << counter;
+        }
+    }
+    out << "\n";
+}
+
+void writeCounterRow(std::ostream &out, int64_t timestampUs, const StageCounters &counters)
+{
+    out << timestampUs;
+    for (const CounterValues &stage : counters.stage)
+    {
+        for (uint64_t value : stage.value)
+        {
+            out << "," << value;
+        }
+    }
+    out << "\n";
+}
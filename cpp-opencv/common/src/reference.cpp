@@ -0,0 +1,97 @@
+#include "reference.hpp"
+
+namespace
+{
+    cv::Mat referenceIgnoreMask(const cv::Size &size)
+    {
+        cv::Mat ignoreMask = cv::Mat::zeros(size, CV_8UC1);
+        std::vector<cv::Point> bottomMiddlePoints = {
+            cv::Point(size.width / 3, size.height * 2 / 3),
+            cv::Point(size.width * 2 / 3, size.height * 2 / 3),
+            cv::Point(size.width, size.height),
+            cv::Point(0, size.height)};
+        cv::fillPoly(ignoreMask, std::vector<std::vector<cv::Point>>{bottomMiddlePoints}, cv::Scalar(255));
+        cv::rectangle(ignoreMask, cv::Rect(0, 0, size.width, static_cast<int>(size.height * 0.55)), cv::Scalar(255), -1);
+        return ignoreMask;
+    }
+
+    std::vector<cv::Point> referenceCentroids(const cv::Mat &mask)
+    {
+        // findContours may change its input, the mask is part of the result
+        cv::Mat contourInput = mask.clone();
+        std::vector<std::vector<cv::Point>> contours;
+        cv::findContours(contourInput, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+
+        std::vector<cv::Point> centroids;
+        for (const std::vector<cv::Point> &contour : contours)
+        {
+            if (cv::contourArea(contour) > 50)
+            {
+                cv::Moments m = cv::moments(contour);
+                if (m.m00 > 0 || m.m00 < 0)
+                {
+                    centroids.push_back(cv::Point(static_cast<int>(m.m10 / m.m00), static_cast<int>(m.m01 / m.m00)));
+                }
+            }
+        }
+        return centroids;
+    }
+
+    bool lower(const cv::Point &a, const cv::Point &b)
+    {
+        return a.y > b.y;
+    }
+
+    double referenceSteering(const cv::Size &frameSize, std::vector<cv::Point> blueCentroids, std::vector<cv::Point> yellowCentroids,
+                             const SteeringConfig &config, SteeringState &state)
+    {
+        cv::Point blueCentroid = state.lastBlueCentroid;
+        cv::Point yellowCentroid = state.lastYellowCentroid;
+        if (!blueCentroids.empty())
+        {
+            blueCentroid = *std::min_element(blueCentroids.begin(), blueCentroids.end(), lower);
+            state.lastBlueCentroid = blueCentroid;
+        }
+        if (!yellowCentroids.empty())
+        {
+            yellowCentroid = *std::min_element(yellowCentroids.begin(), yellowCentroids.end(), lower);
+            state.lastYellowCentroid = yellowCentroid;
+        }
+        if (blueCentroid.x == -1 && blueCentroid.y == -1)
+        {
+            blueCentroid = yellowCentroid + cv::Point(-config.offsetX, config.offsetY);
+        }
+        if (yellowCentroid.x == -1 && yellowCentroid.y == -1)
+        {
+            yellowCentroid = blueCentroid + cv::Point(config.offsetX, config.offsetY);
+        }
+
+        // The closest pair of cones, or the primary centroids if one color has none
+        std::sort(blueCentroids.begin(), blueCentroids.end(), lower);
+        std::sort(yellowCentroids.begin(), yellowCentroids.end(), lower);
+        cv::Point pathCenter((blueCentroid.x + yellowCentroid.x) / 2, (blueCentroid.y + yellowCentroid.y) / 2);
+        if (!blueCentroids.empty() && !yellowCentroids.empty())
+        {
+            pathCenter = cv::Point((blueCentroids[0].x + yellowCentroids[0].x) / 2, (blueCentroids[0].y + yellowCentroids[0].y) / 2);
+        }
+        return -(pathCenter.x - frameSize.width / 2) * config.scaleFactor;
+    }
+}
+
+void runReference(const cv::Mat &img, const SteeringConfig &config, SteeringState &state, ReferenceFrame &result)
+{
+    cv::Mat hsvImage;
+    cv::cvtColor(img, hsvImage, cv::COLOR_BGR2HSV);
+    cv::inRange(hsvImage, config.blueLower, config.blueUpper, result.blueMask);
+    cv::inRange(hsvImage, config.yellowLower, config.yellowUpper, result.yellowMask);
+
+    const cv::Mat ignoreMask = referenceIgnoreMask(img.size());
+    cv::bitwise_and(result.blueMask, ~ignoreMask, result.blueMask);
+    cv::bitwise_and(result.yellowMask, ~ignoreMask, result.yellowMask);
+
+    result.blueCentroids = referenceCentroids(result.blueMask);
+    result.yellowCentroids = referenceCentroids(result.yellowMask);
+    state.blueCentroids = result.blueCentroids;
+    state.yellowCentroids = result.yellowCentroids;
+    result.steering = referenceSteering(img.size(), result.blueCentroids, result.yellowCentroids, config, state);
+}
@@ -0,0 +1,79 @@
+#include "scenecache.hpp"
+#include <limits>
+#include <utility>
+
+namespace
+{
+    // Blocks of the signature, about 20 x 20 pixels at 640 x 480
+    const cv::Size SIGNATURE_BLOCKS(32, 12);
+}
+
+void frameSignature(const cv::Mat &img, cv::Mat &signature)
+{
+    const int top = static_cast<int>(img.rows * 0.55);
+    const cv::Mat roi = img(cv::Rect(0, top, img.cols, img.rows - top));
+    // INTER_AREA averages whole blocks, OpenCV vectorizes it for 8 bit images
+    cv::resize(roi, signature, cv::Size(std::min(SIGNATURE_BLOCKS.width, roi.cols), std::min(SIGNATURE_BLOCKS.height, roi.rows)), 0, 0, cv::INTER_AREA);
+}
+
+double signatureDelta(const cv::Mat &a, const cv::Mat &b)
+{
+    if (a.empty() || a.size() != b.size() || a.type() != b.type())
+    {
+        return std::numeric_limits<double>::infinity();
+    }
+    return cv::norm(a, b, cv::NORM_INF);
+}
+
+double reuseDetection(cv::Mat &img, bool verbose, const SteeringConfig &config, SteeringState &state, StageTimings *timings)
+{
+    if (timings != nullptr)
+    {
+        *timings = StageTimings();
+    }
+    StageClock clock(timings);
+    std::vector<cv::Point> blueCentroids(state.blueCentroids), yellowCentroids(state.yellowCentroids);
+    double steeringAngle;
+    if (verbose)
+    {
+        steeringAngle = computeSteeringAngle(img, blueCentroids, yellowCentroids, config, state);
+        cv::imshow("Processed Frame", img);
+    }
+    else
+    {
+        steeringAngle = steerFromCentroids(img.size(), blueCentroids, yellowCentroids, config, state, nullptr);
+    }
+    clock.mark(STAGE_STEERING);
+    return steeringAngle;
+}
+
+SceneCache::SceneCache(double threshold, int refreshFrames)
+    : threshold_(threshold), refreshFrames_(refreshFrames), processedSignature_(), signature_(), reusedInRow_(0), lastReused_(false),
+      frames_(0), reusedFrames_(0)
+{
+}
+
+void SceneCache::reset()
+{
+    processedSignature_.release();
+    reusedInRow_ = 0;
+    lastReused_ = false;
+}
+
+double SceneCache::process(SteeringEngine engine, cv::Mat &img, bool verbose, const SteeringConfig &config, SteeringState &state,
+                           StageTimings *timings)
+{
+    TRACE_SCOPE("sceneCache");
+    frames_++;
+    frameSignature(img, signature_);
+    lastReused_ = reusedInRow_ < refreshFrames_ && signatureDelta(signature_, processedSignature_) < threshold_;
+    if (!lastReused_)
+    {
+        reusedInRow_ = 0;
+        std::swap(signature_, processedSignature_);
+        return engine(img, verbose, config, state, timings);
+    }
+    reusedInRow_++;
+    reusedFrames_++;
+    return reuseDetection(img, verbose, config, state, timings);
+}
@@ -1,4 +1,7 @@
 #include "steering.hpp"
+#include <chrono>
+#include <fstream>
+#include <sstream>
 
 const cv::Scalar BLUE_LOWER(81, 102, 40);
 const cv::Scalar BLUE_UPPER(148, 255, 123);
@@ -10,23 +13,117 @@ int OFFSET_Y = 48;
 
 double SCALE_FACTOR = 0.001;
 
+const char *const STAGE_NAMES[STAGE_COUNT] = {"hsv", "threshold", "ignore_mask", "centroids", "steering"};
+
 namespace
 {
-    cv::Point lastBlueCentroid(-1, -1);
-    cv::Point lastYellowCentroid(-1, -1);
+    // State of the processFrame overload that works on the global configuration
+    SteeringState globalState = initialSteeringState();
+
+    // Parse "a, b, c" into a scalar
+    bool parseScalar(const std::string &text, cv::Scalar &value)
+    {
+        std::istringstream stream(text);
+        char separator = ',';
+        for (int i = 0; i < 3; i++)
+        {
+            if ((i > 0 && !(stream >> separator)) || separator != ',' || !(stream >> value[i]))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
 }
 
-cv::Point &getLastBlueCentroid() { return lastBlueCentroid; }
-cv::Point &getLastYellowCentroid() { return lastYellowCentroid; }
+cv::Point &getLastBlueCentroid() { return globalState.lastBlueCentroid; }
+cv::Point &getLastYellowCentroid() { return globalState.lastYellowCentroid; }
 
 void setLastBlueCentroid(const cv::Point &centroid)
 {
-    lastBlueCentroid = centroid;
+    globalState.lastBlueCentroid = centroid;
 }
 
 void setLastYellowCentroid(const cv::Point &centroid)
 {
-    lastYellowCentroid = centroid;
+    globalState.lastYellowCentroid = centroid;
+}
+
+SteeringConfig defaultSteeringConfig()
+{
+    return SteeringConfig{BLUE_LOWER, BLUE_UPPER, YELLOW_LOWER, YELLOW_UPPER, OFFSET_X, OFFSET_Y, SCALE_FACTOR, nullptr};
+}
+
+SteeringState initialSteeringState()
+{
+    return SteeringState{cv::Point(-1, -1), cv::Point(-1, -1), {}, {}};
+}
+
+bool loadSteeringConfig(const std::string &path, SteeringConfig &config)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        return false;
+    }
+    SteeringConfig loaded = config;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        // Skip comments and empty lines
+        line = line.substr(0, line.find('#'));
+        if (line.find_first_not_of(" \t\r") == std::string::npos)
+        {
+            continue;
+        }
+        size_t separator = line.find('=');
+        if (separator == std::string::npos)
+        {
+            return false;
+        }
+        std::istringstream keyStream(line.substr(0, separator));
+        std::string key;
+        keyStream >> key;
+        const std::string value = line.substr(separator + 1);
+        std::istringstream valueStream(value);
+        bool valid = false;
+        if (key == "blue_lower")
+        {
+            valid = parseScalar(value, loaded.blueLower);
+        }
+        else if (key == "blue_upper")
+        {
+            valid = parseScalar(value, loaded.blueUpper);
+        }
+        else if (key == "yellow_lower")
+        {
+            valid = parseScalar(value, loaded.yellowLower);
+        }
+        else if (key == "yellow_upper")
+        {
+            valid = parseScalar(value, loaded.yellowUpper);
+        }
+        else if (key == "offset_x")
+        {
+            valid = static_cast<bool>(valueStream >> loaded.offsetX);
+        }
+        else if (key == "offset_y")
+        {
+            valid = static_cast<bool>(valueStream >> loaded.offsetY);
+        }
+        else if (key == "scale_factor")
+        {
+            valid = static_cast<bool>(valueStream >> loaded.scaleFactor);
+        }
+        if (!valid)
+        {
+            return false;
+        }
+    }
+    // Tables of the previous bounds no longer apply
+    loaded.classTables.reset();
+    config = loaded;
+    return true;
 }
 
 cv::Mat createIgnoreMask(cv::Mat &image)
@@ -49,66 +146,68 @@ cv::Mat createIgnoreMask(cv::Mat &image)
     return ignoreMask;
 }
 
-double processFrame(cv::Mat &img, bool verbose)
+const cv::Mat &cachedIgnoreMask(cv::Mat &image)
+{
+    thread_local cv::Mat ignoreMask;
+    if (ignoreMask.size() != image.size())
+    {
+        ignoreMask = createIgnoreMask(image);
+    }
+    return ignoreMask;
+}
+
+void convertToHsv(const cv::Mat &img, cv::Mat &hsvImage)
 {
-    // Convert the image to HSV color space
-    cv::Mat hsvImage;
     cv::cvtColor(img, hsvImage, cv::COLOR_BGR2HSV);
-   
-    // Detect blue and yellow areas
-    cv::Mat blueMask, yellowMask;
-    cv::inRange(hsvImage, BLUE_LOWER, BLUE_UPPER, blueMask);
-    cv::inRange(hsvImage, YELLOW_LOWER, YELLOW_UPPER, yellowMask);
-   
-    // Create and apply the ignore mask
-    cv::Mat ignoreMask = createIgnoreMask(img);
+}
+
+void thresholdCones(const cv::Mat &hsvImage, cv::Mat &blueMask, cv::Mat &yellowMask, const SteeringConfig &config)
+{
+    cv::inRange(hsvImage, config.blueLower, config.blueUpper, blueMask);
+    cv::inRange(hsvImage, config.yellowLower, config.yellowUpper, yellowMask);
+}
+
+void applyIgnoreMask(cv::Mat &blueMask, cv::Mat &yellowMask, const cv::Mat &ignoreMask)
+{
     cv::bitwise_and(blueMask, ~ignoreMask, blueMask); // Apply mask to blue cones too
     cv::bitwise_and(yellowMask, ~ignoreMask, yellowMask);
-   
-    // Find contours for blue and yellow masks
-    std::vector<std::vector<cv::Point>> blueContours, yellowContours;
-    cv::findContours(blueMask, blueContours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
-    cv::findContours(yellowMask, yellowContours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
-   
-    // Store all detected cone centroids
-    std::vector<cv::Point> blueCentroids;
-    std::vector<cv::Point> yellowCentroids;
-   
-    // Process blue contours to find centroids
-    for (size_t i = 0; i < blueContours.size(); i++)
-    {
-        // Filter small contours that might be noise
-        if (cv::contourArea(blueContours[i]) > 50)
-        {
-            cv::Moments m = cv::moments(blueContours[i]);
-            if (m.m00 != 0)
-            {
-                cv::Point centroid(m.m10 / m.m00, m.m01 / m.m00);
-                blueCentroids.push_back(centroid);
-                cv::circle(img, centroid, 5, cv::Scalar(255, 0, 0), -1);
-            }
-        }
-    }
-    
-    // Process yellow contours to find centroids
-    for (size_t i = 0; i < yellowContours.size(); i++)
+}
+
+void thresholdMasks(cv::Mat &img, const SteeringConfig &config, cv::Mat &blueMask, cv::Mat &yellowMask)
+{
+    cv::Mat hsvImage;
+    convertToHsv(img, hsvImage);
+    thresholdCones(hsvImage, blueMask, yellowMask, config);
+    applyIgnoreMask(blueMask, yellowMask, cachedIgnoreMask(img));
+}
+
+std::vector<cv::Point> findConeCentroids(cv::Mat &mask)
+{
+    std::vector<std::vector<cv::Point>> contours;
+    cv::findContours(mask, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+
+    std::vector<cv::Point> centroids;
+    for (size_t i = 0; i < contours.size(); i++)
     {
         // Filter small contours that might be noise
-        if (cv::contourArea(yellowContours[i]) > 50)
+        if (cv::contourArea(contours[i]) > 50)
         {
-            cv::Moments m = cv::moments(yellowContours[i]);
+            cv::Moments m = cv::moments(contours[i]);
             if (m.m00 != 0)
             {
-                cv::Point centroid(m.m10 / m.m00, m.m01 / m.m00);
-                yellowCentroids.push_back(centroid);
-                cv::circle(img, centroid, 5, cv::Scalar(0, 255, 255), -1);
+                centroids.push_back(cv::Point(m.m10 / m.m00, m.m01 / m.m00));
             }
         }
     }
-   
+    return centroids;
+}
+
+double steerFromCentroids(const cv::Size &frameSize, std::vector<cv::Point> &blueCentroids, std::vector<cv::Point> &yellowCentroids,
+                          const SteeringConfig &config, SteeringState &state, SteeringPath *path)
+{
     // Default centroids if none are detected
-    cv::Point blueCentroid = getLastBlueCentroid();
-    cv::Point yellowCentroid = getLastYellowCentroid();
+    cv::Point blueCentroid = state.lastBlueCentroid;
+    cv::Point yellowCentroid = state.lastYellowCentroid;
     
     // Update primary centroids if available
     if (!blueCentroids.empty())
@@ -117,7 +216,7 @@ double processFrame(cv::Mat &img, bool verbose)
         blueCentroid = *std::min_element(blueCentroids.begin(), blueCentroids.end(),
                                          [](const cv::Point &a, const cv::Point &b)
                                          { return a.y > b.y; });
-        setLastBlueCentroid(blueCentroid);
+        state.lastBlueCentroid = blueCentroid;
     }
     if (!yellowCentroids.empty())
     {
@@ -125,99 +224,52 @@ double processFrame(cv::Mat &img, bool verbose)
         yellowCentroid = *std::min_element(yellowCentroids.begin(), yellowCentroids.end(),
                                            [](const cv::Point &a, const cv::Point &b)
                                            { return a.y > b.y; });
-        setLastYellowCentroid(yellowCentroid);
+        state.lastYellowCentroid = yellowCentroid;
     }
    
     // Fallback if no blue cones are visible
     if (blueCentroid.x == -1 && blueCentroid.y == -1)
     {
-        cv::Point lastBlue = getLastBlueCentroid();
+        cv::Point lastBlue = state.lastBlueCentroid;
         if (lastBlue.x != -1 && lastBlue.y != -1)
         {
             blueCentroid = lastBlue;
         }
         else
         {
-            blueCentroid = yellowCentroid + cv::Point(-OFFSET_X, OFFSET_Y);
+            blueCentroid = yellowCentroid + cv::Point(-config.offsetX, config.offsetY);
         }
     }
 
     // Fallback if no yellow cones are visible
     if (yellowCentroid.x == -1 && yellowCentroid.y == -1)
     {
-        cv::Point lastYellow = getLastYellowCentroid();
+        cv::Point lastYellow = state.lastYellowCentroid;
         if (lastYellow.x != -1 && lastYellow.y != -1)
         {
             yellowCentroid = lastYellow;
         }
         else
         {
-            yellowCentroid = blueCentroid + cv::Point(OFFSET_X, OFFSET_Y);
-        }
-    }
-    
-    // Highlight the primary centroids used for steering
-    cv::circle(img, blueCentroid, 8, cv::Scalar(255, 0, 0), 2);
-    cv::circle(img, yellowCentroid, 8, cv::Scalar(0, 255, 255), 2);
-   
-    // Draw lines between centroids of the same color (rails)
-    if (blueCentroids.size() > 1)
-    {
-        // Sort blue centroids by y-coordinate (bottom to top)
-        std::sort(blueCentroids.begin(), blueCentroids.end(),
-                  [](const cv::Point &a, const cv::Point &b)
-                  { return a.y > b.y; });
-        // Draw blue rail
-        for (size_t i = 0; i < blueCentroids.size() - 1; i++)
-        {
-            cv::line(img, blueCentroids[i], blueCentroids[i + 1], cv::Scalar(255, 0, 0), 2);
-        }
-    }
-    if (yellowCentroids.size() > 1)
-    {
-        // Sort yellow centroids by y-coordinate (bottom to top)
-        std::sort(yellowCentroids.begin(), yellowCentroids.end(),
-                  [](const cv::Point &a, const cv::Point &b)
-                  { return a.y > b.y; });
-        // Draw yellow rail
-        for (size_t i = 0; i < yellowCentroids.size() - 1; i++)
-        {
-            cv::line(img, yellowCentroids[i], yellowCentroids[i + 1], cv::Scalar(0, 255, 255), 2);
+            yellowCentroid = blueCentroid + cv::Point(config.offsetX, config.offsetY);
         }
     }
-    
-    // Calculate path center points
+
+    // Sort centroids by y-coordinate (bottom to top, i.e. by distance from the car)
+    std::sort(blueCentroids.begin(), blueCentroids.end(),
+              [](const cv::Point &a, const cv::Point &b)
+              { return a.y > b.y; });
+    std::sort(yellowCentroids.begin(), yellowCentroids.end(),
+              [](const cv::Point &a, const cv::Point &b)
+              { return a.y > b.y; });
+
+    // Create center points between corresponding blue and yellow cones
     std::vector<cv::Point> pathCenterPoints;
-    
-    // Create center path if we have enough cones
     size_t numPoints = std::min(blueCentroids.size(), yellowCentroids.size());
-    if (numPoints > 0)
+    for (size_t i = 0; i < numPoints; i++)
     {
-        // Ensure centroids are sorted by y-coordinate (distance from car)
-        std::sort(blueCentroids.begin(), blueCentroids.end(),
-                  [](const cv::Point &a, const cv::Point &b)
-                  { return a.y > b.y; });
-        std::sort(yellowCentroids.begin(), yellowCentroids.end(),
-                  [](const cv::Point &a, const cv::Point &b)
-                  { return a.y > b.y; });
-        
-                  // Create center points between corresponding blue and yellow cones
-        for (size_t i = 0; i < numPoints; i++)
-        {
-            cv::Point center((blueCentroids[i].x + yellowCentroids[i].x) / 2,
-                             (blueCentroids[i].y + yellowCentroids[i].y) / 2);
-            pathCenterPoints.push_back(center);
-            cv::circle(img, center, 3, cv::Scalar(0, 255, 0), -1);
-        }
-
-        // Draw the center path line
-        if (pathCenterPoints.size() > 1)
-        {
-            for (size_t i = 0; i < pathCenterPoints.size() - 1; i++)
-            {
-                cv::line(img, pathCenterPoints[i], pathCenterPoints[i + 1], cv::Scalar(0, 255, 0), 2);
-            }
-        }
+        pathCenterPoints.push_back(cv::Point((blueCentroids[i].x + yellowCentroids[i].x) / 2,
+                                             (blueCentroids[i].y + yellowCentroids[i].y) / 2));
     }
 
     // Always calculate at least one path center point for steering
@@ -233,17 +285,103 @@ double processFrame(cv::Mat &img, bool verbose)
         pathCenter = cv::Point((blueCentroid.x + yellowCentroid.x) / 2,
                                (blueCentroid.y + yellowCentroid.y) / 2);
     }
+
+    if (path != nullptr)
+    {
+        path->blueCentroid = blueCentroid;
+        path->yellowCentroid = yellowCentroid;
+        path->pathCenter = pathCenter;
+        path->pathCenterPoints.swap(pathCenterPoints);
+    }
+
+    // Calculate the steering angle
+    int imageCenterX = frameSize.width / 2;
+    double steeringAngle = (pathCenter.x - imageCenterX) * config.scaleFactor;
+    return -steeringAngle;
+}
+
+double computeSteeringAngle(cv::Mat &img, std::vector<cv::Point> &blueCentroids, std::vector<cv::Point> &yellowCentroids,
+                            const SteeringConfig &config, SteeringState &state)
+{
+    SteeringPath path{cv::Point(), cv::Point(), cv::Point(), {}};
+    double steeringAngle = steerFromCentroids(img.size(), blueCentroids, yellowCentroids, config, state, &path);
+
+    // Highlight the primary centroids used for steering
+    cv::circle(img, path.blueCentroid, 8, cv::Scalar(255, 0, 0), 2);
+    cv::circle(img, path.yellowCentroid, 8, cv::Scalar(0, 255, 255), 2);
+   
+    // Draw lines between centroids of the same color (rails), the centroids are sorted bottom to top
+    for (size_t i = 1; i < blueCentroids.size(); i++)
+    {
+        cv::line(img, blueCentroids[i - 1], blueCentroids[i], cv::Scalar(255, 0, 0), 2);
+    }
+    for (size_t i = 1; i < yellowCentroids.size(); i++)
+    {
+        cv::line(img, yellowCentroids[i - 1], yellowCentroids[i], cv::Scalar(0, 255, 255), 2);
+    }
+
+    // Draw the center path
+    for (size_t i = 0; i < path.pathCenterPoints.size(); i++)
+    {
+        cv::circle(img, path.pathCenterPoints[i], 3, cv::Scalar(0, 255, 0), -1);
+        if (i > 0)
+        {
+            cv::line(img, path.pathCenterPoints[i - 1], path.pathCenterPoints[i], cv::Scalar(0, 255, 0), 2);
+        }
+    }
    
     // Highlight the main steering point
-    cv::circle(img, pathCenter, 8, cv::Scalar(0, 255, 0), 2);
-    
-    // Calculate the steering angle
-    int imageCenterX = img.cols / 2;
-    double steeringAngle = (pathCenter.x - imageCenterX) * SCALE_FACTOR;
+    cv::circle(img, path.pathCenter, 8, cv::Scalar(0, 255, 0), 2);
     
     // Draw a line from bottom center to path center (steering line)
     cv::Point bottomCenter(img.cols / 2, img.rows);
-    cv::line(img, bottomCenter, pathCenter, cv::Scalar(0, 0, 255), 2);
+    cv::line(img, bottomCenter, path.pathCenter, cv::Scalar(0, 0, 255), 2);
+
+    return steeringAngle;
+}
+
+double processFrame(cv::Mat &img, bool verbose, StageTimings *timings)
+{
+    return processFrame(img, verbose, defaultSteeringConfig(), globalState, timings);
+}
+
+double processFrame(cv::Mat &img, bool verbose, const SteeringConfig &config, SteeringState &state, StageTimings *timings)
+{
+    TRACE_SCOPE("processFrame");
+    StageClock clock(timings);
+
+    // Convert the image to HSV color space
+    cv::Mat hsvImage;
+    convertToHsv(img, hsvImage);
+    clock.mark(STAGE_HSV);
+   
+    // Detect blue and yellow areas
+    cv::Mat blueMask, yellowMask;
+    thresholdCones(hsvImage, blueMask, yellowMask, config);
+    clock.mark(STAGE_THRESHOLD);
+   
+    // Create and apply the ignore mask
+    cv::Mat ignoreMask = createIgnoreMask(img);
+    applyIgnoreMask(blueMask, yellowMask, ignoreMask);
+    clock.mark(STAGE_IGNORE_MASK);
+   
+    // Find the centroids of blue and yellow cones and mark them
+    std::vector<cv::Point> blueCentroids = findConeCentroids(blueMask);
+    std::vector<cv::Point> yellowCentroids = findConeCentroids(yellowMask);
+    state.blueCentroids = blueCentroids;
+    state.yellowCentroids = yellowCentroids;
+    for (const cv::Point &centroid : blueCentroids)
+    {
+        cv::circle(img, centroid, 5, cv::Scalar(255, 0, 0), -1);
+    }
+    for (const cv::Point &centroid : yellowCentroids)
+    {
+        cv::circle(img, centroid, 5, cv::Scalar(0, 255, 255), -1);
+    }
+    clock.mark(STAGE_CENTROIDS);
+
+    double steeringAngle = computeSteeringAngle(img, blueCentroids, yellowCentroids, config, state);
+    clock.mark(STAGE_STEERING);
     
     // Show processed images if verbose
     if (verbose)
@@ -252,5 +390,5 @@ double processFrame(cv::Mat &img, bool verbose)
         cv::imshow("Blue Mask", blueMask);
         cv::imshow("Yellow Mask", yellowMask);
     }
-    return -steeringAngle;
+    return steeringAngle;
 }
\ No newline at end of file
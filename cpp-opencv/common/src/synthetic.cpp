@@ -0,0 +1,93 @@
+#include "synthetic.hpp"
+#include <opencv2/imgproc/imgproc.hpp>
+#include <cmath>
+
+namespace
+{
+    // BGR colors that fall inside the HSV bands of steering.cpp
+    const cv::Scalar BACKGROUND_COLOR(80, 80, 80);
+    const cv::Scalar BLUE_CONE_COLOR(110, 40, 10);
+    const cv::Scalar YELLOW_CONE_COLOR(20, 200, 220);
+
+    // Draw a cone standing on base and return its centroid
+    cv::Point drawCone(cv::Mat &frame, const cv::Point &base, int halfWidth, const cv::Scalar &color)
+    {
+        std::vector<cv::Point> triangle = {
+            base + cv::Point(-halfWidth, 0),
+            base + cv::Point(halfWidth, 0),
+            base + cv::Point(0, -halfWidth * 5 / 2)};
+        cv::fillConvexPoly(frame, triangle, color);
+        return base + cv::Point(0, -halfWidth * 5 / 6);
+    }
+
+    // Shift hue and brightness and scale saturation in HSV space, the hue wraps around like OpenCV's 0..180
+    void shiftLighting(cv::Mat &frame, const SyntheticScene &scene)
+    {
+        cv::Mat hsv;
+        cv::cvtColor(frame, hsv, cv::COLOR_BGR2HSV);
+        const int hueShift = static_cast<int>(std::lround(scene.hueShift));
+        for (int y = 0; y < hsv.rows; y++)
+        {
+            cv::Vec3b *row = hsv.ptr<cv::Vec3b>(y);
+            for (int x = 0; x < hsv.cols; x++)
+            {
+                row[x][0] = static_cast<uint8_t>(((row[x][0] + hueShift) % 180 + 180) % 180);
+                row[x][1] = cv::saturate_cast<uint8_t>(row[x][1] * scene.saturationScale);
+                row[x][2] = cv::saturate_cast<uint8_t>(row[x][2] + scene.valueShift);
+            }
+        }
+        cv::cvtColor(hsv, frame, cv::COLOR_HSV2BGR);
+    }
+}
+
+SyntheticScene defaultSyntheticScene(int width, int height)
+{
+    return SyntheticScene{width, height, 6, 0.0, 42, 1.0, 0.0, 0.0, 1.0, 0.0};
+}
+
+cv::Mat renderConeScene(const SyntheticScene &scene)
+{
+    std::vector<cv::Point> blueCones, yellowCones;
+    return renderConeScene(scene, blueCones, yellowCones);
+}
+
+cv::Mat renderConeScene(const SyntheticScene &scene, std::vector<cv::Point> &blueCones, std::vector<cv::Point> &yellowCones)
+{
+    cv::RNG rng(scene.seed);
+    cv::Mat frame(scene.height, scene.width, CV_8UC3, BACKGROUND_COLOR);
+    blueCones.clear();
+    yellowCones.clear();
+
+    // Place the cones along two rails that converge towards the horizon, inside the
+    // part of the frame that is not covered by createIgnoreMask
+    int conesPerSide = std::max(1, scene.coneCount / 2);
+    for (int i = 0; i < conesPerSide; i++)
+    {
+        double t = (i + 0.5) / conesPerSide; // 0 is closest to the car, 1 is at the horizon
+        int y = static_cast<int>(scene.height * (0.90 - 0.30 * t));
+        int halfWidth = std::max(6, static_cast<int>(scene.width * 0.015 * (1.5 - t) * scene.coneScale));
+        int jitter = rng.uniform(-scene.width / 100, scene.width / 100 + 1);
+        int bend = static_cast<int>(scene.width * scene.curve * t * t);
+        int blueX = static_cast<int>(scene.width * (0.03 + 0.30 * t)) + jitter + bend;
+        int yellowX = static_cast<int>(scene.width * (0.97 - 0.30 * t)) - jitter + bend;
+        blueCones.push_back(drawCone(frame, cv::Point(blueX, y), halfWidth, BLUE_CONE_COLOR));
+        yellowCones.push_back(drawCone(frame, cv::Point(yellowX, y), halfWidth, YELLOW_CONE_COLOR));
+    }
+
+    // Neutral lighting leaves the frame untouched, so the default scenes stay bit identical
+    if (std::fabs(scene.hueShift) > 0 || std::fabs(scene.saturationScale - 1) > 0 || std::fabs(scene.valueShift) > 0)
+    {
+        shiftLighting(frame, scene);
+    }
+
+    // Add gaussian noise on a signed copy so that values saturate instead of wrapping
+    if (scene.noise > 0)
+    {
+        cv::Mat noisy, noise(frame.size(), CV_16SC3);
+        rng.fill(noise, cv::RNG::NORMAL, 0, scene.noise);
+        frame.convertTo(noisy, CV_16SC3);
+        noisy += noise;
+        noisy.convertTo(frame, CV_8UC3);
+    }
+    return frame;
+}
@@ -0,0 +1,158 @@
+#include "tracing.hpp"
+#include <iostream>
+
+#ifdef ENABLE_TRACING
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+    // A thread stops recording at this many events, about 32 MB
+    const size_t MAX_EVENTS_PER_THREAD = 1 << 20;
+
+    struct TraceRecord
+    {
+        const char *name;
+        char phase;
+        int64_t startNs;
+        int64_t durationNs;
+    };
+
+    struct ThreadTrace
+    {
+        int id;
+        std::string name;
+        std::vector<TraceRecord> events;
+        size_t dropped;
+    };
+
+    // Time zero of the trace
+    const std::chrono::steady_clock::time_point TRACE_EPOCH = std::chrono::steady_clock::now();
+
+    // The buffers stay registered after their thread ends, so pool threads that exit are still written
+    std::mutex registryMutex;
+    std::vector<std::shared_ptr<ThreadTrace>> registry;
+
+    ThreadTrace &threadTrace()
+    {
+        thread_local std::shared_ptr<ThreadTrace> trace;
+        if (!trace)
+        {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            trace = std::make_shared<ThreadTrace>(ThreadTrace{static_cast<int>(registry.size()) + 1, std::string(), std::vector<TraceRecord>(), 0});
+            trace->events.reserve(4096);
+            registry.push_back(trace);
+        }
+        return *trace;
+    }
+
+    int64_t sinceEpochNs(const std::chrono::steady_clock::time_point &time)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(time - TRACE_EPOCH).count();
+    }
+
+    void writeString(std::ostream &out, const std::string &value)
+    {
+        out << '"';
+        for (char c : value)
+        {
+            if (c == '"' || c == '\\')
+            {
+                out << '\\';
+            }
+            out << c;
+        }
+        out << '"';
+    }
+}
+
+void traceEvent(const char *name, char phase, const std::chrono::steady_clock::time_point &start,
+                const std::chrono::steady_clock::time_point &end)
+{
+    ThreadTrace &trace = threadTrace();
+    if (trace.events.size() >= MAX_EVENTS_PER_THREAD)
+    {
+        trace.dropped++;
+        return;
+    }
+    const int64_t startNs = sinceEpochNs(start);
+    trace.events.push_back(TraceRecord{name, phase, startNs, (phase == 'X') ? sinceEpochNs(end) - startNs : 0});
+}
+
+void traceThreadName(const std::string &name)
+{
+    threadTrace().name = name;
+}
+
+bool writeTrace(const std::string &path)
+{
+    std::ofstream file(path);
+    if (!file.is_open())
+    {
+        std::cerr << "Error: Could not open trace file " << path << std::endl;
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(registryMutex);
+    size_t events = 0, dropped = 0;
+    bool first = true;
+    // Timestamps are in microseconds, with nanosecond resolution
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" << std::fixed << std::setprecision(3);
+    for (const std::shared_ptr<ThreadTrace> &trace : registry)
+    {
+        if (!trace->name.empty())
+        {
+            file << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << trace->id << ",\"args\":{\"name\":";
+            writeString(file, trace->name);
+            file << "}}";
+            first = false;
+        }
+        for (const TraceRecord &record : trace->events)
+        {
+            file << (first ? "" : ",") << "\n{\"name\":";
+            writeString(file, record.name);
+            file << ",\"ph\":\"" << record.phase << "\",\"pid\":1,\"tid\":" << trace->id << ",\"ts\":" << record.startNs / 1000.0;
+            if (record.phase == 'X')
+            {
+                file << ",\"dur\":" << record.durationNs / 1000.0;
+            }
+            file << "}";
+            first = false;
+        }
+        events += trace->events.size();
+        dropped += trace->dropped;
+    }
+    file << "\n]}\n";
+    if (!file)
+    {
+        std::cerr << "Error: Could not write trace file " << path << std::endl;
+        return false;
+    }
+    std::clog << "Trace: wrote " << events << " events of " << registry.size() << " threads to " << path;
+    if (dropped != 0)
+    {
+        std::clog << ", dropped " << dropped << " events over the per-thread limit";
+    }
+    std::clog << std::endl;
+    return true;
+}
+
+bool checkTraceSupport(const std::string &)
+{
+    return true;
+}
+#else
+bool writeTrace(const std::string &path)
+{
+    return checkTraceSupport(path);
+}
+
+bool checkTraceSupport(const std::string &path)
+{
+    std::cerr << "Error: Could not write trace file " << path << ", tracing is compiled out (build with -DENABLE_TRACING=ON)" << std::endl;
+    return false;
+}
+#endif
@@ -0,0 +1,224 @@
+#define CATCH_CONFIG_MAIN
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include "catch.hpp"
+#include "kernels.hpp"
+#include "scenecache.hpp"
+#include "steering.hpp"
+#include "synthetic.hpp"
+
+#include <cmath>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Run with a machine-readable reporter to keep before/after numbers, for example:
+//   ./main-Benchmark -r xml -o benchmark.xml
+// A single stage can be selected with the test tag, e.g. "[processFrame]".
+
+namespace
+{
+    std::string describe(const std::string &name, const SyntheticScene &scene)
+    {
+        std::ostringstream label;
+        label << name << " " << scene.width << "x" << scene.height
+              << " cones=" << scene.coneCount << " noise=" << scene.noise;
+        if (std::fabs(scene.coneScale - 1) > 0)
+        {
+            label << " cone-scale=" << scene.coneScale;
+        }
+        if (std::fabs(scene.hueShift) > 0 || std::fabs(scene.saturationScale - 1) > 0 || std::fabs(scene.valueShift) > 0)
+        {
+            label << " hsv-shift=" << scene.hueShift << "/" << scene.saturationScale << "/" << scene.valueShift;
+        }
+        return label.str();
+    }
+
+    // Deterministic scenes covering the resolutions, cone counts and noise levels we care about
+    std::vector<SyntheticScene> benchmarkScenes()
+    {
+        std::vector<SyntheticScene> scenes;
+        const cv::Size resolutions[] = {cv::Size(640, 480), cv::Size(1280, 720), cv::Size(1920, 1080), cv::Size(3840, 2160)};
+        const int coneCounts[] = {2, 12};
+        const double noiseLevels[] = {0.0, 12.0};
+        for (const cv::Size &resolution : resolutions)
+        {
+            for (int cones : coneCounts)
+            {
+                for (double noise : noiseLevels)
+                {
+                    SyntheticScene scene = defaultSyntheticScene(resolution.width, resolution.height);
+                    scene.coneCount = cones;
+                    scene.noise = noise;
+                    scenes.push_back(scene);
+                }
+            }
+        }
+        return scenes;
+    }
+
+    // 720p scenes with small and large cones and with the lighting moved towards the edges of the HSV bands
+    std::vector<SyntheticScene> appearanceScenes()
+    {
+        std::vector<SyntheticScene> scenes;
+        const double coneScales[] = {0.5, 1.0, 2.0};
+        // Hue shift, saturation scale and value shift: neutral, dusk, washed out and a warm color cast
+        const double lighting[][3] = {{0, 1.0, 0}, {0, 1.0, -60}, {0, 0.6, 40}, {6, 1.0, 0}};
+        for (double coneScale : coneScales)
+        {
+            for (const double *shift : lighting)
+            {
+                SyntheticScene scene = defaultSyntheticScene(1280, 720);
+                scene.coneCount = 12;
+                scene.noise = 12.0;
+                scene.coneScale = coneScale;
+                scene.hueShift = shift[0];
+                scene.saturationScale = shift[1];
+                scene.valueShift = shift[2];
+                scenes.push_back(scene);
+            }
+        }
+        return scenes;
+    }
+}
+
+TEST_CASE("Benchmark processFrame on synthetic cone frames", "[benchmark][processFrame]")
+{
+    for (const SyntheticScene &scene : benchmarkScenes())
+    {
+        const cv::Mat frame = renderConeScene(scene);
+        // processFrame draws on its input, so every run gets its own copy
+        BENCHMARK_ADVANCED(describe("processFrame", scene))(Catch::Benchmark::Chronometer meter)
+        {
+            std::vector<cv::Mat> frames(meter.runs());
+            for (cv::Mat &copy : frames)
+            {
+                copy = frame.clone();
+            }
+            meter.measure([&frames](int i)
+                          { return processFrame(frames[i], false); });
+        };
+    }
+}
+
+TEST_CASE("Benchmark processFrame across cone sizes and lighting", "[benchmark][processFrame][appearance]")
+{
+    for (const SyntheticScene &scene : appearanceScenes())
+    {
+        const cv::Mat frame = renderConeScene(scene);
+        BENCHMARK_ADVANCED(describe("processFrame", scene))(Catch::Benchmark::Chronometer meter)
+        {
+            std::vector<cv::Mat> frames(meter.runs());
+            for (cv::Mat &copy : frames)
+            {
+                copy = frame.clone();
+            }
+            meter.measure([&frames](int i)
+                          { return processFrame(frames[i], false); });
+        };
+    }
+}
+
+TEST_CASE("Benchmark the individual stages of processFrame", "[benchmark][stages]")
+{
+    for (const SyntheticScene &scene : benchmarkScenes())
+    {
+        cv::Mat frame = renderConeScene(scene);
+        const SteeringConfig config = defaultSteeringConfig();
+
+        // Intermediate results of every stage, used as input for the next stage
+        cv::Mat hsvImage, blueMask, yellowMask;
+        cv::Mat ignoreMask = createIgnoreMask(frame);
+        convertToHsv(frame, hsvImage);
+        thresholdCones(hsvImage, blueMask, yellowMask, config);
+        applyIgnoreMask(blueMask, yellowMask, ignoreMask);
+        const std::vector<cv::Point> blueCentroids = findConeCentroids(blueMask);
+        const std::vector<cv::Point> yellowCentroids = findConeCentroids(yellowMask);
+
+        BENCHMARK(describe("createIgnoreMask", scene))
+        {
+            return createIgnoreMask(frame);
+        };
+        BENCHMARK(describe("convertToHsv", scene))
+        {
+            cv::Mat hsv;
+            convertToHsv(frame, hsv);
+            return hsv;
+        };
+        BENCHMARK(describe("thresholdCones", scene))
+        {
+            cv::Mat blue, yellow;
+            thresholdCones(hsvImage, blue, yellow, config);
+            return blue;
+        };
+        BENCHMARK_ADVANCED(describe("applyIgnoreMask", scene))(Catch::Benchmark::Chronometer meter)
+        {
+            std::vector<cv::Mat> blue(meter.runs()), yellow(meter.runs());
+            for (int i = 0; i < meter.runs(); i++)
+            {
+                blue[i] = blueMask.clone();
+                yellow[i] = yellowMask.clone();
+            }
+            meter.measure([&](int i)
+                          { applyIgnoreMask(blue[i], yellow[i], ignoreMask); });
+        };
+        BENCHMARK(describe("findConeCentroids", scene))
+        {
+            return findConeCentroids(blueMask).size() + findConeCentroids(yellowMask).size();
+        };
+        BENCHMARK_ADVANCED(describe("computeSteeringAngle", scene))(Catch::Benchmark::Chronometer meter)
+        {
+            std::vector<cv::Mat> frames(meter.runs());
+            for (cv::Mat &copy : frames)
+            {
+                copy = frame.clone();
+            }
+            SteeringState state = initialSteeringState();
+            meter.measure([&](int i)
+                          {
+                              std::vector<cv::Point> blue(blueCentroids), yellow(yellowCentroids);
+                              return computeSteeringAngle(frames[i], blue, yellow, config, state); });
+        };
+    }
+}
+
+TEST_CASE("Benchmark the label kernels on BGR and BGRA frames", "[benchmark][kernels]")
+{
+    for (const SyntheticScene &scene : benchmarkScenes())
+    {
+        cv::Mat bgr = renderConeScene(scene), bgra;
+        cv::cvtColor(bgr, bgra, cv::COLOR_BGR2BGRA);
+        const ClassTables tables = buildClassTables(coneColorClasses(defaultSteeringConfig()));
+        const std::vector<PixelSpan> &spans = cachedRegionSpans(bgr);
+        const LabelKernel bgrKernel = selectLabelKernel(bgr.type(), REGION_SPANS);
+        const LabelKernel bgraKernel = selectLabelKernel(bgra.type(), REGION_SPANS);
+        BENCHMARK(describe("labelKernel BGR", scene))
+        {
+            cv::Mat labels;
+            bgrKernel(bgr, tables, spans, labels);
+            return labels;
+        };
+        BENCHMARK(describe("labelKernel BGRA", scene))
+        {
+            cv::Mat labels;
+            bgraKernel(bgra, tables, spans, labels);
+            return labels;
+        };
+    }
+}
+
+TEST_CASE("Benchmark the frame signature of the scene cache", "[benchmark][scenecache]")
+{
+    for (const SyntheticScene &scene : benchmarkScenes())
+    {
+        const cv::Mat frame = renderConeScene(scene);
+        cv::Mat previous;
+        frameSignature(frame, previous);
+        // The cost of a reused frame: its signature and the comparison with the last processed one
+        BENCHMARK(describe("frameSignature", scene))
+        {
+            cv::Mat signature;
+            frameSignature(frame, signature);
+            return signatureDelta(signature, previous);
+        };
+    }
+}
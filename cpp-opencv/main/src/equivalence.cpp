@@ -0,0 +1,71 @@
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+#include "equivalence.hpp"
+#include "synthetic.hpp"
+
+#include <string>
+#include <vector>
+
+// Every engine is checked against the frozen reference pipeline (reference.hpp) on synthetic
+// frames in BGR and BGRA. Recordings are checked with performance --equivalence.
+
+namespace
+{
+    std::vector<cv::Mat> equivalenceFrames()
+    {
+        std::vector<cv::Mat> frames;
+        const cv::Size resolutions[] = {cv::Size(640, 480), cv::Size(1280, 720)};
+        const double curves[] = {-0.2, 0.0, 0.2};
+        for (const cv::Size &resolution : resolutions)
+        {
+            for (int coneCount : {2, 6})
+            {
+                for (double curve : curves)
+                {
+                    for (uint64_t seed = 1; seed <= 3; seed++)
+                    {
+                        SyntheticScene scene = defaultSyntheticScene(resolution.width, resolution.height);
+                        scene.coneCount = coneCount;
+                        scene.curve = curve;
+                        scene.seed = seed;
+                        scene.valueShift = (seed == 3) ? -20.0 : 0.0;
+                        cv::Mat frame = renderConeScene(scene), bgra;
+                        cv::cvtColor(frame, bgra, cv::COLOR_BGR2BGRA);
+                        frames.push_back(frame);
+                        frames.push_back(bgra);
+                    }
+                }
+            }
+        }
+        return frames;
+    }
+
+    void checkEngine(const std::string &engineName, const EquivalenceTolerance &tolerance)
+    {
+        SteeringConfig config = defaultSteeringConfig();
+        EquivalenceCheck check(engineName, config, tolerance);
+        for (const cv::Mat &frame : equivalenceFrames())
+        {
+            check.reset();
+            const FrameEquivalence difference = check.check(frame);
+            INFO(engineName << " on " << frame.cols << "x" << frame.rows << " with " << frame.channels() << " channels: steering "
+                            << difference.steering << ", centroid " << difference.centroidPx << " px, mask " << difference.maskFraction);
+            CHECK(difference.equivalent);
+        }
+    }
+}
+
+TEST_CASE("The contour engine matches the reference exactly", "[equivalence]")
+{
+    checkEngine("contour", EquivalenceTolerance{0.0, 0.0, 0.0});
+}
+
+TEST_CASE("The fastpath engine matches the reference within the tolerance", "[equivalence]")
+{
+    checkEngine("fastpath", defaultEquivalenceTolerance());
+}
+
+TEST_CASE("The labels engine matches the reference within the tolerance", "[equivalence]")
+{
+    checkEngine("labels", defaultEquivalenceTolerance());
+}
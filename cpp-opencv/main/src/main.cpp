@@ -21,6 +21,10 @@
 #include "opendlv-standard-message-set.hpp"
 // Include steering variables and methods
 #include "steering.hpp"
+#include "hotconfig.hpp"
+#include "flightrecorder.hpp"
+#include "perfcounters.hpp"
+#include "scenecache.hpp"
 // Include the GUI and image processing header files from OpenCV
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
@@ -47,11 +51,24 @@ int32_t main(int32_t argc, char **argv)
         (0 == commandlineArguments.count("height")))
     {
         std::cerr << argv[0] << " attaches to a shared memory area containing an ARGB image." << std::endl;
-        std::cerr << "Usage:   " << argv[0] << " --cid=<OD4 session> --name=<name of shared memory area> [--verbose]" << std::endl;
+        std::cerr << "Usage:   " << argv[0] << " --cid=<OD4 session> --name=<name of shared memory area> [--config=<file>] [--engine=<name>] [--flight-recorder=<dir> [--flight-frames=<n>] [--latency-budget=<ms>] [--steering-jump=<angle>]] [--profile] [--reuse-threshold=<levels> [--refresh-frames=<n>]] [--trace=<file.json>] [--verbose]" << std::endl;
         std::cerr << "         --cid:    CID of the OD4Session to send and receive messages" << std::endl;
         std::cerr << "         --name:   name of the shared memory area to attach" << std::endl;
         std::cerr << "         --width:  width of the frame" << std::endl;
         std::cerr << "         --height: height of the frame" << std::endl;
+        std::cerr << "         --config: steering configuration (blue_lower = 81, 102, 40 ...), reloaded whenever the file changes" << std::endl;
+        std::cerr << "         --engine: steering engine (contour, fastpath, histogram, labels; default contour), labels classifies" << std::endl;
+        std::cerr << "                   the BGRA frames of the shared memory without a separate color conversion" << std::endl;
+        std::cerr << "         --flight-recorder: keep the last frames and write them to this directory when a frame is an outlier," << std::endl;
+        std::cerr << "                            replay them with performance --dump=<file>" << std::endl;
+        std::cerr << "         --flight-frames:   number of frames kept (default 40)" << std::endl;
+        std::cerr << "         --latency-budget:  frames that take longer than this many ms are outliers (default 50)" << std::endl;
+        std::cerr << "         --steering-jump:   steering changes between two frames larger than this are outliers (default 0.2)" << std::endl;
+        std::cerr << "         --profile:         print the performance counters of every stage, CPU time and context switches every 300 frames" << std::endl;
+        std::cerr << "         --reuse-threshold: steer from the previous detection while no block of the frame signature changed by this" << std::endl;
+        std::cerr << "                            many intensity levels or more, e.g. 2 (default off)" << std::endl;
+        std::cerr << "         --refresh-frames:  process every frame after this many reused ones in a row (default 10)" << std::endl;
+        std::cerr << "         --trace:           write the spans of every frame as Chrome trace JSON on exit (needs -DENABLE_TRACING=ON)" << std::endl;
         std::cerr << "Example: " << argv[0] << " --cid=253 --name=img --width=640 --height=480 --verbose" << std::endl;
     }
     else
@@ -62,6 +79,62 @@ int32_t main(int32_t argc, char **argv)
         const uint32_t HEIGHT{static_cast<uint32_t>(std::stoi(commandlineArguments["height"]))};
         const bool VERBOSE{commandlineArguments.count("verbose") != 0};
 
+        // The engine is resolved once, the labels engine picks its kernel for the BGRA layout on the first frame
+        const std::string ENGINE_NAME{(commandlineArguments.count("engine") != 0) ? commandlineArguments["engine"] : "contour"};
+        const SteeringEngine ENGINE{findSteeringEngine(ENGINE_NAME)};
+        if (ENGINE == nullptr)
+        {
+            std::cerr << "Error: Unknown steering engine " << ENGINE_NAME << std::endl;
+            return retCode;
+        }
+        // Fail before attaching if the trace cannot be written on exit
+        if (commandlineArguments.count("trace") != 0 && !checkTraceSupport(commandlineArguments["trace"]))
+        {
+            return retCode;
+        }
+
+        // The frame loop picks up a new configuration at the start of the next frame without locking
+        HotConfig steeringConfig(defaultSteeringConfig());
+        if (commandlineArguments.count("config") != 0)
+        {
+            const std::string CONFIG{commandlineArguments["config"]};
+            SteeringConfig config = defaultSteeringConfig();
+            if (!loadSteeringConfig(CONFIG, config))
+            {
+                std::cerr << "Error: Could not load steering configuration " << CONFIG << std::endl;
+                return retCode;
+            }
+            steeringConfig.publish(config);
+            steeringConfig.watch(CONFIG, std::chrono::milliseconds(500));
+        }
+        SteeringState steeringState = initialSteeringState();
+
+        // Optional flight recorder for latency and steering outliers
+        std::unique_ptr<FlightRecorder> flightRecorder;
+        if (commandlineArguments.count("flight-recorder") != 0)
+        {
+            const size_t FLIGHT_FRAMES{(commandlineArguments.count("flight-frames") != 0) ? std::stoul(commandlineArguments["flight-frames"]) : 40};
+            const FlightTrigger TRIGGER{(commandlineArguments.count("latency-budget") != 0) ? std::stod(commandlineArguments["latency-budget"]) : 50.0,
+                                        (commandlineArguments.count("steering-jump") != 0) ? std::stod(commandlineArguments["steering-jump"]) : 0.2};
+            flightRecorder.reset(new FlightRecorder(FLIGHT_FRAMES, cv::Size(static_cast<int>(WIDTH), static_cast<int>(HEIGHT)), CV_8UC4,
+                                                    TRIGGER, commandlineArguments["flight-recorder"], ENGINE_NAME));
+        }
+
+        // Optional performance counters of every stage, summarized every PROFILE_FRAMES frames
+        const bool PROFILE{commandlineArguments.count("profile") != 0};
+        const size_t PROFILE_FRAMES{300};
+        StageCounters frameCounters = StageCounters();
+        CounterSummary counterSummary;
+        ResourceUsage usageStart = resourceUsage();
+
+        // Optional reuse of the detection while the scene does not change, e.g. at standstill
+        std::unique_ptr<SceneCache> sceneCache;
+        if (commandlineArguments.count("reuse-threshold") != 0)
+        {
+            const int REFRESH_FRAMES{(commandlineArguments.count("refresh-frames") != 0) ? std::stoi(commandlineArguments["refresh-frames"]) : 10};
+            sceneCache.reset(new SceneCache(std::stod(commandlineArguments["reuse-threshold"]), REFRESH_FRAMES));
+        }
+
         // Attach to the shared memory.
         std::unique_ptr<cluon::SharedMemory> sharedMemory{new cluon::SharedMemory{NAME}};
 
@@ -80,12 +153,14 @@ int32_t main(int32_t argc, char **argv)
             {
                 // The envelope data structure provide further details, such as sampleTimePoint as shown in this test case:
                 // https://github.com/chrberger/libcluon/blob/master/libcluon/testsuites/TestEnvelopeConverter.cpp#L31-L40
+                TRACE_SCOPE("groundSteeringRequest");
                 std::lock_guard<std::mutex> lck(gsrMutex);
                 gsr = cluon::extractMessage<opendlv::proxy::GroundSteeringRequest>(std::move(env));
                 // std::cout << "lambda: groundSteering = " << gsr.groundSteering() << std::endl;
             };
 
             od4.dataTrigger(opendlv::proxy::GroundSteeringRequest::ID(), onGroundSteeringRequest);
+            TRACE_THREAD_NAME("frames");
 
             // Endless loop; end the program by pressing Ctrl-C.
             while (od4.isRunning())
@@ -94,11 +169,15 @@ int32_t main(int32_t argc, char **argv)
                 cv::Mat img;
 
                 // Wait for a notification of a new frame.
+                TRACE_BEGIN("waitForFrame");
                 sharedMemory->wait();
+                TRACE_END("waitForFrame");
+                TRACE_SCOPE("frame");
 
                 // Lock the shared memory.
                 sharedMemory->lock();
                 {
+                    TRACE_SCOPE("copyFrame");
                     // Copy the pixels from the shared memory into our own data structure.
                     cv::Mat wrapped(HEIGHT, WIDTH, CV_8UC4, sharedMemory->data());
                     img = wrapped.clone();
@@ -142,7 +221,33 @@ int32_t main(int32_t argc, char **argv)
                 cv::putText(img, final_string, text_position, font_face, font_scale, text_color, thickness);
 
                 // Pass the frame to the helper function for processing
-                double steeringAngle = processFrame(img, VERBOSE);
+                const ConfigSnapshot &snapshot = steeringConfig.acquire();
+                if (flightRecorder)
+                {
+                    TRACE_SCOPE("flightRecorder");
+                    img.copyTo(flightRecorder->nextImage(snapshot.config, steeringState));
+                }
+                StageTimings timings = StageTimings();
+                CountStages countStages(PROFILE ? &frameCounters : nullptr);
+                auto frameStart = std::chrono::steady_clock::now();
+                double steeringAngle = sceneCache ? sceneCache->process(ENGINE, img, VERBOSE, snapshot.config, steeringState, &timings)
+                                                  : ENGINE(img, VERBOSE, snapshot.config, steeringState, &timings);
+                if (PROFILE)
+                {
+                    counterSummary.addFrame(frameCounters);
+                    if (counterSummary.frames() == PROFILE_FRAMES)
+                    {
+                        const ResourceUsage usageEnd = resourceUsage();
+                        counterSummary.print(std::clog, usageSince(usageStart, usageEnd));
+                        counterSummary = CounterSummary();
+                        usageStart = usageEnd;
+                    }
+                }
+                if (flightRecorder)
+                {
+                    const double frameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+                    flightRecorder->endFrame(ts_ms, steeringAngle, frameMs, timings, sceneCache && sceneCache->lastReused());
+                }
                 std::string direction = (steeringAngle > 0) ? "left" : "right";
                 std::cout << "group_06;" << ts_ms << ";" << steeringAngle << std::endl;
 
@@ -160,7 +265,15 @@ int32_t main(int32_t argc, char **argv)
                 }
             }
         }
-        retCode = 0;
+        // The OD4 session is closed here, so no thread adds spans anymore
+        if (commandlineArguments.count("trace") != 0 && !writeTrace(commandlineArguments["trace"]))
+        {
+            retCode = 1;
+        }
+        else
+        {
+            retCode = 0;
+        }
     }
     computedFile.close();
     return retCode;
@@ -3,6 +3,10 @@ set terminal png size 1300,600
 if (!exists("output_png")) output_png = 'plot.png'
 set output output_png
 
+# Input is downsampled by performance (--plot/--joined), the previous run column is optional
+if (!exists("input_csv")) input_csv = 'comb.csv'
+if (!exists("has_previous")) has_previous = 1
+
 # Title and labels
 set title "Steering Values Over Time"
 set xlabel "Timestamp" offset 0,-1
@@ -36,6 +40,11 @@ set style line 2 linewidth 2 linecolor rgb "#dd0000"  # Ground Steering
 set style line 3 linewidth 2 linecolor rgb "#00aa00"  # Previous Ground Steering
 
 # Plot command
-plot 'comb.csv' using 1:2 with lines linestyle 1 title 'Ground Truth', \
-     '' using 1:4 with lines linestyle 3 title 'Previous Ground Steering', \
-     '' using 1:3 with lines linestyle 2 title 'Ground Steering'
\ No newline at end of file
+if (has_previous) {
+    plot input_csv using 1:2 with lines linestyle 1 title 'Ground Truth', \
+         '' using 1:4 with lines linestyle 3 title 'Previous Ground Steering', \
+         '' using 1:3 with lines linestyle 2 title 'Ground Steering'
+} else {
+    plot input_csv using 1:2 with lines linestyle 1 title 'Ground Truth', \
+         '' using 1:3 with lines linestyle 2 title 'Ground Steering'
+}
\ No newline at end of file
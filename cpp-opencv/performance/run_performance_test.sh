@@ -5,6 +5,13 @@ OUTPUT_DIR="plots"
 CSV_OUTPUT_DIR="output"
 PREVIOUS_OUTPUT_DIR="previous_plots"
 COMMIT_HASH="$1"
+# Repetitions used for the timing statistics and the allowed slowdown in percent against the previous job
+TIMING_REPETITIONS="${TIMING_REPETITIONS:-5}"
+MAX_SLOWDOWN="${MAX_SLOWDOWN:-25}"
+# Number of rows the plotted series are downsampled to, keeps plotting time independent of the recording length
+PLOT_POINTS="${PLOT_POINTS:-2000}"
+# Rows of the previous job are joined within this many microseconds, older jobs stamped frames with the ground truth time
+JOIN_TOLERANCE_US="${JOIN_TOLERANCE_US:-50000}"
 
 # Create directories if they don't exist
 mkdir -p "${OUTPUT_DIR}"
@@ -72,6 +79,9 @@ for rec_file in "${RECORDING_DIR}"/*.rec; do
   filename=$(basename "${rec_file}" .rec)
   output_png="${OUTPUT_DIR}/${filename}_${COMMIT_HASH}.png"
   output_csv="${CSV_OUTPUT_DIR}/${filename}_${COMMIT_HASH}_current.csv" 
+  timing_csv="${filename}_${COMMIT_HASH}_timing.csv"
+  results_bin="${filename}_${COMMIT_HASH}_results.bin"
+  current_plot_csv="current_plot.csv"
   combined_csv="comb.csv"
   
   echo "Processing recording file: ${filename}.rec"
@@ -82,19 +92,72 @@ for rec_file in "${RECORDING_DIR}"/*.rec; do
   docker run \
     -v "$(pwd)/${RECORDING_DIR}:/data" \
     -v "$(pwd)/${CSV_OUTPUT_DIR}:/output" \
+    -v "$(pwd):/work" \
     performance:latest \
     --rec="/data/${filename}.rec" \
-    --output="/output/${filename}_${COMMIT_HASH}.csv"
+    --output="/output/${filename}_${COMMIT_HASH}.csv" \
+    --repeat="${TIMING_REPETITIONS}" \
+    --timing="/output/${timing_csv}" \
+    --results="/output/${results_bin}" \
+    --plot="/work/${current_plot_csv}" \
+    --plot-points="${PLOT_POINTS}"
   
   if [ $? -ne 0 ]; then
     echo "Error processing ${filename}.rec"
     exit 1
   fi
 
-  # Find the most recent matching previous CSV file (excluding _current)
+  # Fail on a significant runtime regression against the timing summary of the previous job
   if [ -d "${PREVIOUS_OUTPUT_DIR}/cpp-opencv/performance/output" ]; then
-    echo "Looking for most recent previous CSV file matching: ${filename}*.csv (excluding _current files)"
-    previous_csv_file=$(find "${PREVIOUS_OUTPUT_DIR}/cpp-opencv/performance/output" -name "${filename}*.csv" ! -name "*_current.csv")
+    previous_timing_file=$(find "${PREVIOUS_OUTPUT_DIR}/cpp-opencv/performance/output" -name "${filename}*_timing.csv" | head -n 1)
+
+    if [ -n "$previous_timing_file" ]; then
+      echo "Comparing timing against: ${previous_timing_file}"
+      docker run \
+        -v "$(pwd)/${CSV_OUTPUT_DIR}:/output" \
+        -v "$(pwd)/$(dirname "${previous_timing_file}"):/previous" \
+        performance:latest \
+        --timing="/output/${timing_csv}" \
+        --baseline="/previous/$(basename "${previous_timing_file}")" \
+        --max-slowdown="${MAX_SLOWDOWN}"
+
+      if [ $? -ne 0 ]; then
+        echo "Error: ${filename}.rec got more than ${MAX_SLOWDOWN}% slower than the previous job"
+        exit 1
+      fi
+    else
+      echo "No previous timing summary found for ${filename}, skipping the runtime regression check"
+    fi
+  fi
+
+  # Prefer joining the binary results of the previous job by timestamp, older jobs only have CSV files
+  previous_results_file=""
+  if [ -d "${PREVIOUS_OUTPUT_DIR}/cpp-opencv/performance/output" ]; then
+    previous_results_file=$(find "${PREVIOUS_OUTPUT_DIR}/cpp-opencv/performance/output" -name "${filename}*_results.bin" | head -n 1)
+  fi
+
+  if [ -n "$previous_results_file" ]; then
+    echo "Comparing results against: ${previous_results_file}"
+    docker run \
+      -v "$(pwd):/work" \
+      -v "$(pwd)/$(dirname "${previous_results_file}"):/previous" \
+      performance:latest \
+      --compare="/work/${CSV_OUTPUT_DIR}/${results_bin}" \
+      --against="/previous/$(basename "${previous_results_file}")" \
+      --joined="/work/${combined_csv}" \
+      --join-tolerance="${JOIN_TOLERANCE_US}" \
+      --plot-points="${PLOT_POINTS}"
+
+    if [ $? -ne 0 ]; then
+      echo "Error comparing result files"
+      exit 1
+    fi
+
+    plotting_csv="${combined_csv}"
+  elif [ -d "${PREVIOUS_OUTPUT_DIR}/cpp-opencv/performance/output" ]; then
+    # Find the most recent matching previous CSV file (excluding _current)
+    echo "Looking for most recent previous CSV file matching: ${filename}*.csv (excluding _current and _timing files)"
+    previous_csv_file=$(find "${PREVIOUS_OUTPUT_DIR}/cpp-opencv/performance/output" -name "${filename}*.csv" ! -name "*_current.csv" ! -name "*_timing.csv")
     
     if [ -n "$previous_csv_file" ]; then
       echo "Found previous CSV file: ${previous_csv_file}"
@@ -113,16 +176,20 @@ for rec_file in "${RECORDING_DIR}"/*.rec; do
       plotting_csv="${combined_csv}"
     else
       echo "No previous CSV file found for ${filename} (excluding _current files), using current CSV only"
-      plotting_csv="${output_csv}"
+      plotting_csv="${current_plot_csv}"
     fi
   else
     echo "Previous output directory not found, using current CSV only"
-    plotting_csv="${output_csv}"
+    plotting_csv="${current_plot_csv}"
   fi
 
   # Generate plot using the selected CSV file
   echo "Generating plot from: ${plotting_csv}"
-  gnuplot -e "output_png='${output_png}'" plot_script.gnuplot
+  has_previous=1
+  if [ "${plotting_csv}" = "${current_plot_csv}" ]; then
+    has_previous=0
+  fi
+  gnuplot -e "output_png='${output_png}'; input_csv='${plotting_csv}'; has_previous=${has_previous}" plot_script.gnuplot
   
   if [ $? -ne 0 ]; then
     echo "Error generating plot"
@@ -0,0 +1,240 @@
+#include "cluon-complete.hpp"
+#include "recording.hpp"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // Sample time range relative to the first envelope of the recording
+    struct TimeRange
+    {
+        int64_t fromUs;
+        int64_t toUs;
+    };
+
+    // Parse "10-20,45.5-60" (seconds), returns false on a malformed or empty range
+    bool parseRanges(const std::string &spec, std::vector<TimeRange> &ranges)
+    {
+        std::istringstream list(spec);
+        std::string item;
+        while (std::getline(list, item, ','))
+        {
+            const size_t dash = item.find('-');
+            if (dash == std::string::npos)
+            {
+                return false;
+            }
+            try
+            {
+                const double from = std::stod(item.substr(0, dash));
+                const double to = std::stod(item.substr(dash + 1));
+                if (to <= from)
+                {
+                    return false;
+                }
+                ranges.push_back(TimeRange{static_cast<int64_t>(from * 1e6), static_cast<int64_t>(to * 1e6)});
+            }
+            catch (const std::exception &)
+            {
+                return false;
+            }
+        }
+        return !ranges.empty();
+    }
+
+    // Parse a positive number of seconds, returns false if it is malformed
+    bool parseSeconds(const std::string &spec, int64_t &us)
+    {
+        try
+        {
+            size_t parsed = 0;
+            const double seconds = std::stod(spec, &parsed);
+            if (parsed != spec.size() || seconds <= 0)
+            {
+                return false;
+            }
+            us = static_cast<int64_t>(seconds * 1e6);
+            return true;
+        }
+        catch (const std::exception &)
+        {
+            return false;
+        }
+    }
+
+    // Close a shard, returns false if any write to it failed
+    bool closeShard(std::ofstream &shardFile, const std::string &path)
+    {
+        shardFile.close();
+        if (!shardFile)
+        {
+            std::cerr << "Error: Could not write the output recording " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // True if the H264 access unit contains an IDR slice (NAL unit type 5), the decoder can start there
+    bool isIdrFrame(const uint8_t *data, size_t size)
+    {
+        for (size_t i = 0; i + 3 < size; i++)
+        {
+            if (data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 1 && (data[i + 3] & 0x1F) == 5)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::string shardPath(const std::string &out, int shard)
+    {
+        const size_t dot = out.find_last_of('.');
+        char number[16];
+        std::snprintf(number, sizeof(number), "-%04d", shard);
+        return (dot == std::string::npos) ? out + number : out.substr(0, dot) + number + out.substr(dot);
+    }
+}
+
+int32_t main(int32_t argc, char **argv)
+{
+    auto commandlineArguments = cluon::getCommandlineArguments(argc, argv);
+    if (commandlineArguments.count("rec") == 0 || commandlineArguments.count("out") == 0)
+    {
+        std::cerr << argv[0] << " writes a recording that only holds the images and ground truth of another one." << std::endl;
+        std::cerr << "Usage:   " << argv[0] << " --rec=<Recording.rec> --out=<Compact.rec> [--ranges=<from>-<to>,...] [--shard-seconds=<s>]" << std::endl;
+        std::cerr << "         --ranges:        only keep these time ranges, in seconds from the start of the recording" << std::endl;
+        std::cerr << "         --shard-seconds: split the output into <Compact>-0000.rec, ... of about s seconds each" << std::endl;
+        std::cerr << "Every range and every shard starts at an IDR frame, so it can be decoded on its own." << std::endl;
+        std::cerr << "Example: " << argv[0] << " --rec=myRecording.rec --out=slim.rec --ranges=0-60 --shard-seconds=20" << std::endl;
+        return 1;
+    }
+    const std::string out = commandlineArguments["out"];
+    std::vector<TimeRange> ranges;
+    if (commandlineArguments.count("ranges") != 0 && !parseRanges(commandlineArguments["ranges"], ranges))
+    {
+        std::cerr << "Error: Could not parse the time ranges " << commandlineArguments["ranges"] << std::endl;
+        return 1;
+    }
+    int64_t shardUs = 0;
+    if (commandlineArguments.count("shard-seconds") != 0 && !parseSeconds(commandlineArguments["shard-seconds"], shardUs))
+    {
+        std::cerr << "Error: Could not parse the shard length " << commandlineArguments["shard-seconds"] << std::endl;
+        return 1;
+    }
+
+    RecordingReader recording(commandlineArguments["rec"]);
+    if (!recording.isOpen())
+    {
+        std::cerr << "Error: Could not open recording " << commandlineArguments["rec"] << std::endl;
+        return 1;
+    }
+    recording.setTypeFilter({1055, 1090});
+    recording.setMemoryBudget(256 * 1024 * 1024);
+    const int64_t startUs = recording.firstSampleTimeUs();
+
+    std::ofstream shardFile;
+    std::string shardFilePath;
+    int shards = 0;
+    int64_t shardStartUs = 0;
+    bool waitForIdr = true;          // Images are dropped until the next IDR frame after a cut
+    int activeRange = -1;            // Range of the previous envelope, a change means a cut
+    RecordedEnvelope lastSteering{0, 0, nullptr, 0, nullptr, 0};
+    uint64_t envelopesWritten = 0, bytesWritten = 0, imagesSkipped = 0;
+
+    RecordedEnvelope envelope{0, 0, nullptr, 0, nullptr, 0};
+    while (recording.next(envelope))
+    {
+        const int64_t relativeUs = envelope.sampleTimeUs - startUs;
+        int range = 0;
+        if (!ranges.empty())
+        {
+            range = -1;
+            for (size_t i = 0; i < ranges.size(); i++)
+            {
+                if (relativeUs >= ranges[i].fromUs && relativeUs < ranges[i].toUs)
+                {
+                    range = static_cast<int>(i);
+                    break;
+                }
+            }
+        }
+        if (range != activeRange)
+        {
+            waitForIdr = true;
+            activeRange = range;
+        }
+        if (envelope.dataType == 1090)
+        {
+            lastSteering = envelope;
+        }
+        if (range < 0)
+        {
+            continue;
+        }
+
+        if (envelope.dataType == 1055)
+        {
+            ImageView image{"", 0, 0, nullptr, 0};
+            const bool idr = parseImageReading(envelope.payload, envelope.payloadSize, image) &&
+                             isIdrFrame(image.data, image.dataSize);
+            // Open a new shard at the first IDR frame after a cut or once the current shard is long enough
+            const bool shardFull = shards > 0 && shardUs > 0 && envelope.sampleTimeUs - shardStartUs >= shardUs;
+            if (idr && (shards == 0 || shardFull))
+            {
+                if (shards > 0 && !closeShard(shardFile, shardFilePath))
+                {
+                    return 1;
+                }
+                shardFilePath = (shardUs > 0) ? shardPath(out, shards) : out;
+                shardFile.open(shardFilePath, std::ios::binary);
+                if (!shardFile.is_open())
+                {
+                    std::cerr << "Error: Could not open output recording " << shardFilePath << std::endl;
+                    return 1;
+                }
+                shards++;
+                shardStartUs = envelope.sampleTimeUs;
+                // Start with the latest ground truth so that the first frame of the shard has a steering value
+                if (lastSteering.raw != nullptr)
+                {
+                    shardFile.write(reinterpret_cast<const char *>(lastSteering.raw), static_cast<std::streamsize>(lastSteering.rawSize));
+                    envelopesWritten++;
+                    bytesWritten += lastSteering.rawSize;
+                }
+            }
+            if (idr)
+            {
+                waitForIdr = false;
+            }
+            if (waitForIdr || shards == 0)
+            {
+                imagesSkipped++;
+                continue;
+            }
+        }
+        else if (shards == 0)
+        {
+            continue;
+        }
+        shardFile.write(reinterpret_cast<const char *>(envelope.raw), static_cast<std::streamsize>(envelope.rawSize));
+        envelopesWritten++;
+        bytesWritten += envelope.rawSize;
+    }
+    if (shards == 0)
+    {
+        std::cerr << "Error: No IDR frame in the selected part of the recording" << std::endl;
+        return 1;
+    }
+    if (!closeShard(shardFile, shardFilePath))
+    {
+        return 1;
+    }
+    std::cout << "Wrote " << envelopesWritten << " envelopes (" << bytesWritten << " bytes) to " << shards
+              << " file(s), skipped " << imagesSkipped << " images before an IDR frame" << std::endl;
+    return 0;
+}
@@ -0,0 +1,101 @@
+#include "decimation.hpp"
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+bool parseDecimation(const std::string &spec, SteeringEngine engine, const SteeringConfig &config,
+                     std::vector<DecimationRate> &rates, std::string &error)
+{
+    std::istringstream list(spec);
+    std::string item;
+    while (std::getline(list, item, ','))
+    {
+        DecimationRate rate{item, 0, 0, engine, config, initialSteeringState(), cv::Mat(), 0, 0, 0, 0, 0, 0};
+        try
+        {
+            size_t parsed = 0;
+            if (item.size() > 2 && 0 == item.compare(item.size() - 2, 2, "hz"))
+            {
+                rate.targetHz = std::stod(item.substr(0, item.size() - 2), &parsed);
+                parsed += 2;
+            }
+            else
+            {
+                rate.everyNth = std::stoi(item, &parsed);
+                rate.label = "1/" + item;
+            }
+            if (parsed != item.size() || (rate.everyNth <= 0 && rate.targetHz <= 0))
+            {
+                throw std::invalid_argument(item);
+            }
+        }
+        catch (const std::exception &)
+        {
+            error = "invalid decimation rate '" + item + "', expected e.g. 2 or 15hz";
+            return false;
+        }
+        rates.push_back(rate);
+    }
+    if (rates.empty())
+    {
+        error = "no decimation rate given";
+        return false;
+    }
+    return true;
+}
+
+void runDecimation(const cv::Mat &frame, uint64_t frameIndex, int64_t timeUs, bool hasGroundTruth, float groundTruth,
+                   double threshold, std::vector<DecimationRate> &rates)
+{
+    for (DecimationRate &rate : rates)
+    {
+        bool due = false;
+        if (rate.everyNth > 0)
+        {
+            due = (frameIndex % static_cast<uint64_t>(rate.everyNth)) == 0;
+        }
+        else if (rate.processed == 0 || timeUs >= rate.nextDueUs)
+        {
+            // Keep the schedule, but do not try to catch up after a gap in the recording
+            const int64_t periodUs = static_cast<int64_t>(1e6 / rate.targetHz);
+            rate.nextDueUs = (rate.processed == 0 || timeUs - rate.nextDueUs >= periodUs) ? timeUs + periodUs : rate.nextDueUs + periodUs;
+            due = true;
+        }
+        if (due)
+        {
+            frame.copyTo(rate.frame);
+            auto start = std::chrono::steady_clock::now();
+            rate.heldSteering = rate.engine(rate.frame, false, rate.config, rate.state, nullptr);
+            rate.cpuMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            rate.processed++;
+        }
+        // Determine difference between held and truth values, unless gsr is 0
+        if (hasGroundTruth && std::fabs(groundTruth) > 0)
+        {
+            rate.totalValid++;
+            if (std::abs(rate.heldSteering - groundTruth) <= threshold)
+            {
+                rate.withinRange++;
+            }
+        }
+    }
+}
+
+void printDecimation(std::ostream &out, const std::vector<DecimationRate> &rates)
+{
+    out << std::left << std::setw(10) << "rate" << std::right << std::setw(10) << "processed" << std::setw(12) << "accuracy"
+        << std::setw(12) << "cpu_ms" << std::setw(12) << "ms/frame" << std::setw(12) << "cpu_vs_" + rates[0].label << std::endl;
+    out << std::fixed << std::setprecision(2);
+    for (const DecimationRate &rate : rates)
+    {
+        const double accuracy = rate.totalValid > 0 ? 100.0 * rate.withinRange / rate.totalValid : 0.0;
+        const double perFrame = rate.processed > 0 ? rate.cpuMs / rate.processed : 0.0;
+        const double relative = rates[0].cpuMs > 0 ? 100.0 * rate.cpuMs / rates[0].cpuMs : 0.0;
+        out << std::left << std::setw(10) << rate.label << std::right << std::setw(10) << rate.processed
+            << std::setw(11) << accuracy << "%" << std::setw(12) << rate.cpuMs << std::setw(12) << perFrame
+            << std::setw(11) << relative << "%" << std::endl;
+    }
+    out.unsetf(std::ios::fixed);
+}
@@ -0,0 +1,42 @@
+#ifndef DECIMATION_HPP
+#define DECIMATION_HPP
+
+#include "steering.hpp"
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// One processing rate of the decimation study. Only some frames are processed, the last
+// steering value is held for the frames in between, like the car would do at that rate.
+struct DecimationRate
+{
+    std::string label;
+    int everyNth;             // Process every nth decoded frame, 0 if a target rate is used
+    double targetHz;          // Process at most this many frames per second of sample time
+    SteeringEngine engine;
+    SteeringConfig config;
+    SteeringState state;
+    cv::Mat frame;            // Private copy of the decoded frame, engines draw on it
+    double heldSteering;
+    int64_t nextDueUs;
+    uint64_t processed;
+    double cpuMs;
+    int totalValid;
+    int withinRange;
+};
+
+// Parse a comma separated list of rates, "2" processes every second frame and "15hz" at most
+// 15 frames per second. Every rate runs the given engine and configuration.
+bool parseDecimation(const std::string &spec, SteeringEngine engine, const SteeringConfig &config,
+                     std::vector<DecimationRate> &rates, std::string &error);
+
+// Feed a decoded frame to every rate. groundTruth is only counted if hasGroundTruth is set,
+// frames without ground truth are still processed when due as the car would see them.
+void runDecimation(const cv::Mat &frame, uint64_t frameIndex, int64_t timeUs, bool hasGroundTruth, float groundTruth,
+                   double threshold, std::vector<DecimationRate> &rates);
+
+// Print accuracy and CPU cost of every rate, the cost is relative to the first rate
+void printDecimation(std::ostream &out, const std::vector<DecimationRate> &rates);
+
+#endif
@@ -0,0 +1,225 @@
+#include "detectioncache.hpp"
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <sys/stat.h>
+
+namespace
+{
+    const char MAGIC[8] = {'C', 'C', 'D', 'E', 'T', 'E', 'C', 'T'};
+    const char INDEX_MAGIC[8] = {'C', 'C', 'D', 'E', 'T', 'I', 'D', 'X'};
+    const uint32_t VERSION = 1;
+    // Bump when createIgnoreMask or the minimum cone area in findConeCentroids change
+    const char DETECTION_VERSION[] = "ignore-mask-1,min-area-50";
+    const size_t HEADER_BYTES = sizeof(MAGIC) + sizeof(uint32_t) + 2 * sizeof(uint64_t) + 2 * sizeof(int32_t);
+    const size_t RECORD_BYTES = sizeof(int64_t) + sizeof(float) + 2 * sizeof(uint16_t);
+    const size_t TRAILER_BYTES = 2 * sizeof(uint64_t) + sizeof(INDEX_MAGIC);
+
+    template <typename T>
+    void writeValue(std::ofstream &file, const T &value)
+    {
+        file.write(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    T readValue(const char *data)
+    {
+        T value;
+        std::memcpy(&value, data, sizeof(T));
+        return value;
+    }
+
+    void writePoints(std::ofstream &file, const std::vector<cv::Point> &points)
+    {
+        for (const cv::Point &point : points)
+        {
+            writeValue(file, static_cast<int16_t>(point.x));
+            writeValue(file, static_cast<int16_t>(point.y));
+        }
+    }
+
+    void readPoints(const char *&data, uint16_t count, std::vector<cv::Point> &points)
+    {
+        points.resize(count);
+        for (cv::Point &point : points)
+        {
+            point.x = readValue<int16_t>(data);
+            point.y = readValue<int16_t>(data + sizeof(int16_t));
+            data += 2 * sizeof(int16_t);
+        }
+    }
+
+    // FNV-1a, stable across platforms unlike std::hash
+    void hashBytes(uint64_t &hash, const void *data, size_t length)
+    {
+        const unsigned char *bytes = static_cast<const unsigned char *>(data);
+        for (size_t i = 0; i < length; i++)
+        {
+            hash ^= bytes[i];
+            hash *= 1099511628211ULL;
+        }
+    }
+
+    void hashScalar(uint64_t &hash, const cv::Scalar &scalar)
+    {
+        for (int i = 0; i < 3; i++)
+        {
+            const double value = scalar[i];
+            hashBytes(hash, &value, sizeof(value));
+        }
+    }
+}
+
+DetectionWriter::DetectionWriter(const std::string &path, uint64_t configHash, uint64_t recordingBytes)
+    : file_(path, std::ios::binary), frameSize_(), offsets_()
+{
+    if (!file_.is_open())
+    {
+        return;
+    }
+    file_.write(MAGIC, sizeof(MAGIC));
+    writeValue(file_, VERSION);
+    writeValue(file_, configHash);
+    writeValue(file_, recordingBytes);
+    // The frame size is only known after the first decoded frame and is patched in on close
+    writeValue(file_, static_cast<int32_t>(0));
+    writeValue(file_, static_cast<int32_t>(0));
+}
+
+DetectionWriter::~DetectionWriter()
+{
+    close();
+}
+
+void DetectionWriter::append(const cv::Size &frameSize, const DetectionRecord &record)
+{
+    if (!file_.is_open())
+    {
+        return;
+    }
+    frameSize_ = frameSize;
+    offsets_.push_back(static_cast<uint64_t>(file_.tellp()));
+    writeValue(file_, record.timestamp);
+    writeValue(file_, record.groundTruth);
+    writeValue(file_, static_cast<uint16_t>(record.blue.size()));
+    writeValue(file_, static_cast<uint16_t>(record.yellow.size()));
+    writePoints(file_, record.blue);
+    writePoints(file_, record.yellow);
+}
+
+void DetectionWriter::close()
+{
+    if (!file_.is_open())
+    {
+        return;
+    }
+    const uint64_t indexOffset = static_cast<uint64_t>(file_.tellp());
+    for (uint64_t offset : offsets_)
+    {
+        writeValue(file_, offset);
+    }
+    writeValue(file_, indexOffset);
+    writeValue(file_, static_cast<uint64_t>(offsets_.size()));
+    file_.write(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    file_.seekp(static_cast<std::streamoff>(HEADER_BYTES - 2 * sizeof(int32_t)));
+    writeValue(file_, static_cast<int32_t>(frameSize_.width));
+    writeValue(file_, static_cast<int32_t>(frameSize_.height));
+    file_.close();
+}
+
+DetectionReader::DetectionReader(const std::string &path)
+    : valid_(false), configHash_(0), recordingBytes_(0), frameSize_(), data_(), offsets_()
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+    {
+        return;
+    }
+    data_.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    if (data_.size() < HEADER_BYTES + TRAILER_BYTES || !file.read(data_.data(), static_cast<std::streamsize>(data_.size())))
+    {
+        return;
+    }
+    const char *header = data_.data();
+    const char *trailer = data_.data() + data_.size() - TRAILER_BYTES;
+    if (0 != std::memcmp(header, MAGIC, sizeof(MAGIC)) || readValue<uint32_t>(header + sizeof(MAGIC)) != VERSION ||
+        0 != std::memcmp(trailer + 2 * sizeof(uint64_t), INDEX_MAGIC, sizeof(INDEX_MAGIC)))
+    {
+        return;
+    }
+    configHash_ = readValue<uint64_t>(header + sizeof(MAGIC) + sizeof(uint32_t));
+    recordingBytes_ = readValue<uint64_t>(header + sizeof(MAGIC) + sizeof(uint32_t) + sizeof(uint64_t));
+    frameSize_.width = readValue<int32_t>(header + HEADER_BYTES - 2 * sizeof(int32_t));
+    frameSize_.height = readValue<int32_t>(header + HEADER_BYTES - sizeof(int32_t));
+
+    const uint64_t indexOffset = readValue<uint64_t>(trailer);
+    const uint64_t count = readValue<uint64_t>(trailer + sizeof(uint64_t));
+    if (indexOffset < HEADER_BYTES || indexOffset + count * sizeof(uint64_t) != data_.size() - TRAILER_BYTES)
+    {
+        return;
+    }
+    offsets_.resize(count);
+    std::memcpy(offsets_.data(), data_.data() + indexOffset, count * sizeof(uint64_t));
+    for (uint64_t offset : offsets_)
+    {
+        if (offset < HEADER_BYTES || offset + RECORD_BYTES > indexOffset)
+        {
+            return;
+        }
+    }
+    valid_ = true;
+}
+
+bool DetectionReader::read(size_t index, DetectionRecord &record) const
+{
+    if (index >= offsets_.size())
+    {
+        return false;
+    }
+    const char *data = data_.data() + offsets_[index];
+    record.timestamp = readValue<int64_t>(data);
+    record.groundTruth = readValue<float>(data + sizeof(int64_t));
+    const uint16_t blueCount = readValue<uint16_t>(data + sizeof(int64_t) + sizeof(float));
+    const uint16_t yellowCount = readValue<uint16_t>(data + sizeof(int64_t) + sizeof(float) + sizeof(uint16_t));
+    const size_t end = offsets_[index] + RECORD_BYTES + (blueCount + yellowCount) * 2 * sizeof(int16_t);
+    if (end > data_.size() - TRAILER_BYTES)
+    {
+        return false;
+    }
+    data += RECORD_BYTES;
+    readPoints(data, blueCount, record.blue);
+    readPoints(data, yellowCount, record.yellow);
+    return true;
+}
+
+uint64_t detectionConfigHash(const std::string &engine, const SteeringConfig &config)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    hashBytes(hash, DETECTION_VERSION, sizeof(DETECTION_VERSION));
+    hashBytes(hash, engine.data(), engine.size());
+    hashScalar(hash, config.blueLower);
+    hashScalar(hash, config.blueUpper);
+    hashScalar(hash, config.yellowLower);
+    hashScalar(hash, config.yellowUpper);
+    return hash;
+}
+
+std::string detectionCachePath(const std::string &directory, const std::string &recFile, uint64_t configHash)
+{
+    std::string name = recFile.substr(recFile.find_last_of('/') + 1);
+    name = name.substr(0, name.find_last_of('.'));
+    std::ostringstream path;
+    path << directory << "/" << name << "-" << std::hex << std::setw(16) << std::setfill('0') << configHash << ".det";
+    return path.str();
+}
+
+uint64_t fileSize(const std::string &path)
+{
+    struct stat info;
+    if (0 != stat(path.c_str(), &info))
+    {
+        return 0;
+    }
+    return static_cast<uint64_t>(info.st_size);
+}
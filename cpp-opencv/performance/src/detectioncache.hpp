@@ -0,0 +1,79 @@
+#ifndef DETECTIONCACHE_HPP
+#define DETECTIONCACHE_HPP
+
+#include "steering.hpp"
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Cone detections of one processed frame
+struct DetectionRecord
+{
+    int64_t timestamp;
+    float groundTruth;
+    std::vector<cv::Point> blue;
+    std::vector<cv::Point> yellow;
+};
+
+// Per-frame detections of a recording, so that the steering math can be re-evaluated without
+// decoding and thresholding the frames again. Host byte order like the result files.
+//
+//   header:  "CCDETECT" uint32 version, uint64 configHash, uint64 recordingBytes, int32 width, int32 height
+//   record:  int64 timestamp, float groundTruth, uint16 blueCount, uint16 yellowCount,
+//            (blueCount + yellowCount) x (int16 x, int16 y)
+//   index:   uint64 offset of every record
+//   trailer: uint64 indexOffset, uint64 recordCount, "CCDETIDX"
+//
+// A file without trailer (e.g. from an aborted replay) is rejected by the reader.
+class DetectionWriter
+{
+public:
+    DetectionWriter(const std::string &path, uint64_t configHash, uint64_t recordingBytes);
+    ~DetectionWriter();
+    DetectionWriter(const DetectionWriter &) = delete;
+    DetectionWriter &operator=(const DetectionWriter &) = delete;
+
+    bool isOpen() const { return file_.is_open(); }
+    void append(const cv::Size &frameSize, const DetectionRecord &record);
+    void close();
+
+private:
+    std::ofstream file_;
+    cv::Size frameSize_;
+    std::vector<uint64_t> offsets_;
+};
+
+// Loads a whole detection file, records can be read in order or by index
+class DetectionReader
+{
+public:
+    explicit DetectionReader(const std::string &path);
+
+    bool isOpen() const { return valid_; }
+    uint64_t configHash() const { return configHash_; }
+    uint64_t recordingBytes() const { return recordingBytes_; }
+    const cv::Size &frameSize() const { return frameSize_; }
+    size_t size() const { return offsets_.size(); }
+    bool read(size_t index, DetectionRecord &record) const;
+
+private:
+    bool valid_;
+    uint64_t configHash_;
+    uint64_t recordingBytes_;
+    cv::Size frameSize_;
+    std::vector<char> data_;
+    std::vector<uint64_t> offsets_;
+};
+
+// Hash of everything that influences the detections of an engine: the engine name, the HSV bounds
+// and the version of the fixed detection parameters (ignore mask, minimum cone area)
+uint64_t detectionConfigHash(const std::string &engine, const SteeringConfig &config);
+
+// <directory>/<recording name>-<hash>.det
+std::string detectionCachePath(const std::string &directory, const std::string &recFile, uint64_t configHash);
+
+// Size of a file in bytes or 0 if it does not exist
+uint64_t fileSize(const std::string &path);
+
+#endif
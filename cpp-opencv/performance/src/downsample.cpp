@@ -0,0 +1,170 @@
+#include "downsample.hpp"
+#include <algorithm>
+#include <cmath>
+
+std::vector<size_t> downsampleLttb(const std::vector<double> &x, const std::vector<std::vector<double>> &series, size_t points)
+{
+    StreamingLttb lttb(x.size(), points);
+    std::vector<double> row(series.size());
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (size_t i = 0; i < x.size(); i++)
+        {
+            for (size_t s = 0; s < series.size(); s++)
+            {
+                row[s] = series[s][i];
+            }
+            if (pass == 0)
+            {
+                lttb.average(x[i], row);
+            }
+            else
+            {
+                lttb.select(x[i], row);
+            }
+        }
+    }
+    return lttb.indices();
+}
+
+StreamingLttb::StreamingLttb(size_t rows, size_t points)
+    : rows_(rows), points_(points), bucketSize_(0), sumX_(), sumSeries_(), lastX_(0), lastSeries_(), averaged_(0), averageBucket_(0),
+      selected_(0), selectBucket_(0), averageX_(0), averageSeries_(), largestArea_(-1), bestIndex_(0), bestX_(0), bestSeries_(),
+      indices_(), x_(), series_()
+{
+    // The first and the last row are kept, the rows in between are split into points - 2 buckets
+    if (points_ >= 3 && rows_ > points_)
+    {
+        bucketSize_ = static_cast<double>(rows_ - 2) / (points_ - 2);
+        // One more range than buckets, it holds the rows after the last bucket (usually only the last row)
+        sumX_.assign(points_ - 1, 0.0);
+        sumSeries_.resize(points_ - 1);
+    }
+}
+
+size_t StreamingLttb::bucketBegin(size_t bucket) const
+{
+    return std::min(static_cast<size_t>(std::floor(bucket * bucketSize_)) + 1, rows_);
+}
+
+void StreamingLttb::average(double x, const std::vector<double> &series)
+{
+    const size_t i = averaged_++;
+    if (sumX_.empty() || i == 0)
+    {
+        return;
+    }
+    if (i == rows_ - 1)
+    {
+        lastX_ = x;
+        lastSeries_ = series;
+    }
+    while (i >= bucketBegin(averageBucket_ + 1))
+    {
+        averageBucket_++;
+    }
+    std::vector<double> &sum = sumSeries_[averageBucket_];
+    sum.resize(series.size(), 0.0);
+    sumX_[averageBucket_] += x;
+    for (size_t s = 0; s < series.size(); s++)
+    {
+        sum[s] += series[s];
+    }
+}
+
+void StreamingLttb::select(double x, const std::vector<double> &series)
+{
+    const size_t i = selected_++;
+    if (sumX_.empty())
+    {
+        // Every row, or only the ends if there are too few points for a bucket in between
+        if (points_ == 0 || rows_ <= points_ || i == 0 || (points_ == 2 && i == rows_ - 1))
+        {
+            keep(i, x, series);
+        }
+        return;
+    }
+    if (i == 0)
+    {
+        keep(i, x, series);
+        return;
+    }
+    const size_t bucketCount = points_ - 2;
+    if (i == rows_ - 1)
+    {
+        if (selectBucket_ < bucketCount)
+        {
+            keepBest();
+        }
+        keep(i, x, series);
+        return;
+    }
+    if (i == 1)
+    {
+        startBucket();
+    }
+    while (selectBucket_ < bucketCount && i >= bucketBegin(selectBucket_ + 1))
+    {
+        keepBest();
+        selectBucket_++;
+        startBucket();
+    }
+    // Rounding can leave a row between the last bucket and the last row, it is never kept
+    if (selectBucket_ == bucketCount)
+    {
+        return;
+    }
+
+    // Keep the row that spans the largest triangle with the last kept row and the average of the
+    // next bucket, summed over all series
+    const double previousX = x_.back();
+    const std::vector<double> &previous = series_.back();
+    double area = 0;
+    for (size_t s = 0; s < series.size(); s++)
+    {
+        area += std::abs((previousX - averageX_) * (series[s] - previous[s]) -
+                         (previousX - x) * (averageSeries_[s] - previous[s]));
+    }
+    if (area > largestArea_)
+    {
+        largestArea_ = area;
+        bestIndex_ = i;
+        bestX_ = x;
+        bestSeries_ = series;
+    }
+}
+
+void StreamingLttb::startBucket()
+{
+    // Average of the rows up to the next bucket end, or the last row if there are none, is the third
+    // corner of the triangle
+    const size_t next = selectBucket_ + 1;
+    if (next < sumX_.size() && bucketBegin(next + 1) > bucketBegin(next))
+    {
+        const double count = static_cast<double>(bucketBegin(next + 1) - bucketBegin(next));
+        averageX_ = sumX_[next] / count;
+        averageSeries_ = sumSeries_[next];
+        for (double &y : averageSeries_)
+        {
+            y /= count;
+        }
+    }
+    else
+    {
+        averageX_ = lastX_;
+        averageSeries_ = lastSeries_;
+    }
+    largestArea_ = -1;
+}
+
+void StreamingLttb::keep(size_t index, double x, const std::vector<double> &series)
+{
+    indices_.push_back(index);
+    x_.push_back(x);
+    series_.push_back(series);
+}
+
+void StreamingLttb::keepBest()
+{
+    keep(bestIndex_, bestX_, bestSeries_);
+}
@@ -0,0 +1,62 @@
+#ifndef DOWNSAMPLE_HPP
+#define DOWNSAMPLE_HPP
+
+#include <cstddef>
+#include <vector>
+
+// Largest-Triangle-Three-Buckets downsampling over several series that share the same x values.
+// Returns the indices of at most `points` rows (always including the first and, from 2 points
+// on, the last one) chosen so that the peaks of every series survive. All rows are kept if there
+// are fewer than `points` of them or if `points` is 0.
+std::vector<size_t> downsampleLttb(const std::vector<double> &x, const std::vector<std::vector<double>> &series, size_t points);
+
+// The same downsampling for rows that are streamed instead of held in memory, e.g. read from a
+// result file. The number of rows must be known up front. Every row is passed to average() and
+// then, in the same order, to select(); the buckets only keep their averages and the best row so
+// far, so the memory is proportional to points, not to the number of rows.
+class StreamingLttb
+{
+public:
+    StreamingLttb(size_t rows, size_t points);
+
+    // First pass over the rows
+    void average(double x, const std::vector<double> &series);
+    // Second pass over the rows
+    void select(double x, const std::vector<double> &series);
+
+    // The selected rows in stream order, complete after the last row passed select()
+    const std::vector<size_t> &indices() const { return indices_; }
+    const std::vector<double> &x() const { return x_; }
+    const std::vector<std::vector<double>> &series() const { return series_; }
+
+private:
+    size_t bucketBegin(size_t bucket) const;
+    void startBucket();
+    void keep(size_t index, double x, const std::vector<double> &series);
+    void keepBest();
+
+    size_t rows_;
+    size_t points_;
+    double bucketSize_;
+    // First pass: sums of the buckets and the last row, the third corner of the last bucket
+    std::vector<double> sumX_;
+    std::vector<std::vector<double>> sumSeries_;
+    double lastX_;
+    std::vector<double> lastSeries_;
+    size_t averaged_;
+    size_t averageBucket_;
+    // Second pass: the average of the next bucket and the best row of the current one
+    size_t selected_;
+    size_t selectBucket_;
+    double averageX_;
+    std::vector<double> averageSeries_;
+    double largestArea_;
+    size_t bestIndex_;
+    double bestX_;
+    std::vector<double> bestSeries_;
+    std::vector<size_t> indices_;
+    std::vector<double> x_;
+    std::vector<std::vector<double>> series_;
+};
+
+#endif
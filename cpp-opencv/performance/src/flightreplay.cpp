@@ -0,0 +1,161 @@
+#include "flightreplay.hpp"
+#include "perfcounters.hpp"
+#include "scenecache.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+
+namespace
+{
+    double median(std::vector<double> values)
+    {
+        std::sort(values.begin(), values.end());
+        return values.empty() ? 0.0 : values[values.size() / 2];
+    }
+
+    // Median frame and stage times of repeated runs of one variant on one frame. Every run starts
+    // from the state before the frame, the state of the last run is kept. Unless counters is nullptr,
+    // the performance counters of the last run are stored in it.
+    void profileFrame(const FlightFrame &frame, Variant &variant, int repetitions, StageCounters *counters)
+    {
+        const SteeringConfig &config = variant.configPath.empty() ? frame.config : variant.config;
+        const SteeringState before = variant.state;
+        std::vector<double> frameMs, stageMs[STAGE_COUNT];
+        for (int run = 0; run < repetitions; run++)
+        {
+            variant.state = before;
+            frame.image.copyTo(variant.frame);
+            StageTimings timings = StageTimings();
+            CountStages count(counters);
+            auto start = std::chrono::steady_clock::now();
+            variant.steering = frame.reused ? reuseDetection(variant.frame, false, config, variant.state, &timings)
+                                            : variant.engine(variant.frame, false, config, variant.state, &timings);
+            frameMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+            for (int stage = 0; stage < STAGE_COUNT; stage++)
+            {
+                stageMs[stage].push_back(timings.ms[stage]);
+            }
+        }
+        variant.frameMs = median(frameMs);
+        for (int stage = 0; stage < STAGE_COUNT; stage++)
+        {
+            variant.timings.ms[stage] = median(stageMs[stage]);
+        }
+    }
+
+    void printStages(std::ostream &out, const StageTimings &timings)
+    {
+        for (int stage = 0; stage < STAGE_COUNT; stage++)
+        {
+            out << " " << std::setw(14) << timings.ms[stage];
+        }
+    }
+}
+
+bool replayFlightDump(std::ostream &out, const std::string &path, const FlightDump &dump, std::vector<Variant> &variants, int repetitions,
+                      bool profile)
+{
+    const std::vector<FlightFrame> &frames = dump.frames;
+    if (frames.empty())
+    {
+        return false;
+    }
+    for (Variant &variant : variants)
+    {
+        variant.state = dump.initialState;
+    }
+    size_t slowest = 0;
+    for (size_t i = 0; i < frames.size(); i++)
+    {
+        if (frames[i].frameMs > frames[slowest].frameMs)
+        {
+            slowest = i;
+        }
+    }
+    out << "Flight dump " << path << ": " << frames.size() << " frames of " << frames[0].image.cols << "x" << frames[0].image.rows
+        << " around a " << dump.reason << " outlier of the " << dump.engine << " engine, median of " << repetitions << " run(s) per frame" << std::endl;
+
+    // Header: frame, time since the first frame, then the car and every variant
+    out << std::fixed << std::setprecision(3);
+    out << std::setw(5) << "frame" << " " << std::setw(9) << "time_ms" << " " << std::setw(9) << "car_ms";
+    for (const Variant &variant : variants)
+    {
+        out << " " << std::setw(9) << (variant.label + "_ms");
+    }
+    out << " " << std::setw(9) << "car_steer";
+    for (const Variant &variant : variants)
+    {
+        out << " " << std::setw(9) << (variant.label + "_steer");
+    }
+    if (profile)
+    {
+        for (const char *owner : {"car", "replay"})
+        {
+            for (int stage = 0; stage < STAGE_COUNT; stage++)
+            {
+                out << " " << std::setw(14) << (std::string(owner) + "_" + STAGE_NAMES[stage]);
+            }
+        }
+        for (const char *counter : COUNTER_NAMES)
+        {
+            out << " " << std::setw(14) << counter;
+        }
+    }
+    out << std::endl;
+
+    // Performance counters of the first variant with profile
+    StageCounters counters = StageCounters();
+    CounterSummary counterSummary;
+    const ResourceUsage usageStart = resourceUsage();
+    double carSumMs = 0, replaySumMs = 0, replayMaxMs = 0, maxSteeringDifference = 0;
+    for (size_t i = 0; i < frames.size(); i++)
+    {
+        const FlightFrame &frame = frames[i];
+        for (size_t v = 0; v < variants.size(); v++)
+        {
+            profileFrame(frame, variants[v], repetitions, (profile && v == 0) ? &counters : nullptr);
+        }
+        out << std::setw(5) << i << " " << std::setw(9) << (frame.timestampUs - frames[0].timestampUs) / 1000.0
+            << " " << std::setw(9) << frame.frameMs;
+        for (const Variant &variant : variants)
+        {
+            out << " " << std::setw(9) << variant.frameMs;
+        }
+        out << " " << std::setw(9) << frame.steering;
+        for (const Variant &variant : variants)
+        {
+            out << " " << std::setw(9) << variant.steering;
+        }
+        if (profile)
+        {
+            printStages(out, frame.timings);
+            printStages(out, variants[0].timings);
+            // Counters of the whole frame, the summary below splits them by stage
+            for (int counter = 0; counter < COUNTER_COUNT; counter++)
+            {
+                uint64_t total = 0;
+                for (const CounterValues &stage : counters.stage)
+                {
+                    total += stage.value[counter];
+                }
+                out << " " << std::setw(14) << total;
+            }
+            counterSummary.addFrame(counters);
+        }
+        out << ((i == slowest) ? "  <- slowest on the car" : "") << std::endl;
+
+        carSumMs += frame.frameMs;
+        replaySumMs += variants[0].frameMs;
+        replayMaxMs = std::max(replayMaxMs, variants[0].frameMs);
+        maxSteeringDifference = std::max(maxSteeringDifference, std::fabs(frame.steering - variants[0].steering));
+    }
+    out << "Car: mean " << carSumMs / frames.size() << " ms, max " << frames[slowest].frameMs << " ms. "
+        << variants[0].label << ": mean " << replaySumMs / frames.size() << " ms, max " << replayMaxMs << " ms" << std::endl;
+    out << "Largest steering difference to the car: " << maxSteeringDifference << std::endl;
+    if (profile)
+    {
+        counterSummary.print(out, usageSince(usageStart, resourceUsage()));
+    }
+    return true;
+}
@@ -0,0 +1,19 @@
+#ifndef FLIGHTREPLAY_HPP
+#define FLIGHTREPLAY_HPP
+
+#include "flightrecorder.hpp"
+#include "variants.hpp"
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Re-run the frames of a flight recorder dump (see flightrecorder.hpp) through every variant and
+// print the frame time and steering the car measured next to the ones measured here. Every variant
+// starts from the state of the car before the window and, unless it has a config file of its own,
+// uses the configuration the car had for each frame. Frames the car steered from its previous
+// detection are steered the same way. Every frame is processed repetitions times from the same state
+// and the median is reported, profile adds the time of every stage. Returns false if the dump has no frames.
+bool replayFlightDump(std::ostream &out, const std::string &path, const FlightDump &dump, std::vector<Variant> &variants, int repetitions,
+                      bool profile);
+
+#endif
@@ -0,0 +1,109 @@
+#include "join.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+
+FrameJoiner::FrameJoiner(int64_t toleranceUs)
+    : toleranceUs_(toleranceUs), watermarkUs_(std::numeric_limits<int64_t>::min()), finished_(false),
+      groundTruth_(), pending_(), resolved_(), frames_(0), matched_(0), dropped_(0)
+{
+}
+
+void FrameJoiner::addGroundTruth(int64_t timeUs, float groundTruth)
+{
+    auto position = std::upper_bound(groundTruth_.begin(), groundTruth_.end(), timeUs, [](int64_t time, const Sample &sample)
+                                     { return time < sample.timeUs; });
+    groundTruth_.insert(position, Sample{timeUs, groundTruth});
+    resolve();
+}
+
+void FrameJoiner::addFrame(uint64_t id, int64_t timeUs)
+{
+    pending_.push_back(FrameMatch{id, timeUs, false, 0, 0});
+    frames_++;
+    resolve();
+}
+
+void FrameJoiner::advanceTo(int64_t timeUs)
+{
+    watermarkUs_ = std::max(watermarkUs_, timeUs);
+    resolve();
+}
+
+void FrameJoiner::finish()
+{
+    finished_ = true;
+    resolve();
+}
+
+bool FrameJoiner::next(FrameMatch &match)
+{
+    if (resolved_.empty())
+    {
+        return false;
+    }
+    match = resolved_.front();
+    resolved_.pop_front();
+    return true;
+}
+
+void FrameJoiner::reset()
+{
+    watermarkUs_ = std::numeric_limits<int64_t>::min();
+    finished_ = false;
+    groundTruth_.clear();
+    pending_.clear();
+    resolved_.clear();
+    frames_ = 0;
+    matched_ = 0;
+    dropped_ = 0;
+}
+
+void FrameJoiner::resolve()
+{
+    while (!pending_.empty())
+    {
+        FrameMatch &frame = pending_.front();
+        // First ground truth at or after the frame, together with the one before it these are the candidates
+        auto after = std::lower_bound(groundTruth_.begin(), groundTruth_.end(), frame.frameTimeUs, [](const Sample &sample, int64_t time)
+                                      { return sample.timeUs < time; });
+        // Ground truth that arrives later can only be nearer if it lies before the first one at or after
+        // the frame, or within the tolerance if there is none yet. Both are settled once the watermark
+        // has passed them.
+        const bool complete = finished_ || (after != groundTruth_.end() && watermarkUs_ >= after->timeUs) ||
+                              watermarkUs_ > frame.frameTimeUs + toleranceUs_;
+        if (!complete)
+        {
+            break;
+        }
+        auto nearest = nearestSample(groundTruth_.begin(), groundTruth_.end(), frame.frameTimeUs, toleranceUs_);
+        if (nearest != groundTruth_.end())
+        {
+            frame.matched = true;
+            frame.groundTruthTimeUs = nearest->timeUs;
+            frame.groundTruth = nearest->value;
+            matched_++;
+        }
+        else
+        {
+            dropped_++;
+        }
+        resolved_.push_back(frame);
+        pending_.pop_front();
+    }
+    // Ground truth that is out of tolerance for every pending frame and for everything that can still be
+    // added is no longer needed
+    int64_t oldestUseful = watermarkUs_;
+    for (const FrameMatch &frame : pending_)
+    {
+        oldestUseful = std::min(oldestUseful, frame.frameTimeUs);
+    }
+    if (oldestUseful == std::numeric_limits<int64_t>::min())
+    {
+        return;
+    }
+    while (!groundTruth_.empty() && groundTruth_.front().timeUs < oldestUseful - toleranceUs_)
+    {
+        groundTruth_.pop_front();
+    }
+}
@@ -0,0 +1,86 @@
+#ifndef JOIN_HPP
+#define JOIN_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <iterator>
+
+// A frame and the ground truth sample it was matched with
+struct FrameMatch
+{
+    uint64_t frameId;
+    int64_t frameTimeUs;
+    bool matched;             // False if there is no ground truth within the tolerance
+    int64_t groundTruthTimeUs;
+    float groundTruth;
+};
+
+// The matching rule of FrameJoiner: the sample of [begin, end), sorted by timeUs, that is nearest
+// to timeUs, or end if none is within toleranceUs. On a tie the earlier sample wins, it is the one
+// the car had when the frame was taken.
+template <class Iterator>
+Iterator nearestSample(Iterator begin, Iterator end, int64_t timeUs, int64_t toleranceUs)
+{
+    typedef typename std::iterator_traits<Iterator>::value_type Sample;
+    const Iterator after = std::lower_bound(begin, end, timeUs, [](const Sample &sample, int64_t time)
+                                            { return sample.timeUs < time; });
+    Iterator nearest = end;
+    if (after != begin)
+    {
+        nearest = after - 1;
+    }
+    if (after != end && (nearest == end || after->timeUs - timeUs < timeUs - nearest->timeUs))
+    {
+        nearest = after;
+    }
+    return (nearest != end && std::abs(nearest->timeUs - timeUs) <= toleranceUs) ? nearest : end;
+}
+
+// Matches every frame with the ground truth sample that has the nearest sample time, within a
+// tolerance. The order in which frames and ground truth arrive does not matter, as long as the
+// caller reports with advanceTo() up to which sample time both streams are complete. A frame is
+// resolved once the watermark has passed the first ground truth at or after it, or the end of its
+// tolerance, since no ground truth that arrives later can be nearer. Only a small window is kept.
+class FrameJoiner
+{
+public:
+    explicit FrameJoiner(int64_t toleranceUs);
+
+    void addGroundTruth(int64_t timeUs, float groundTruth);
+    void addFrame(uint64_t id, int64_t timeUs);
+    // Nothing with a sample time before timeUs will be added anymore
+    void advanceTo(int64_t timeUs);
+    // Both streams ended, every pending frame gets resolved
+    void finish();
+    // Next resolved frame, frames are returned in the order they were added
+    bool next(FrameMatch &match);
+    // Forget all frames and ground truth and the counts, e.g. before replaying again
+    void reset();
+
+    uint64_t frames() const { return frames_; }
+    uint64_t matched() const { return matched_; }
+    uint64_t dropped() const { return dropped_; }
+
+private:
+    struct Sample
+    {
+        int64_t timeUs;
+        float value;
+    };
+
+    void resolve();
+
+    int64_t toleranceUs_;
+    int64_t watermarkUs_;
+    bool finished_;
+    std::deque<Sample> groundTruth_;   // Sorted by sample time
+    std::deque<FrameMatch> pending_;
+    std::deque<FrameMatch> resolved_;
+    uint64_t frames_;
+    uint64_t matched_;
+    uint64_t dropped_;
+};
+
+#endif
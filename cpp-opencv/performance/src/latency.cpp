@@ -0,0 +1,158 @@
+#include "latency.hpp"
+#include "join.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+namespace
+{
+    const char MEASURED[] = "measured";
+    const char SAMPLES[] = "samples";
+
+    double percentage(int part, int total)
+    {
+        return total > 0 ? 100.0 * part / total : 0.0;
+    }
+}
+
+bool parseLatencies(const std::string &spec, std::vector<std::string> &latencies, std::string &error)
+{
+    std::istringstream list(spec);
+    std::string item;
+    while (std::getline(list, item, ','))
+    {
+        if (item != MEASURED)
+        {
+            try
+            {
+                size_t parsed = 0;
+                if (std::stod(item, &parsed) < 0 || parsed != item.size())
+                {
+                    throw std::invalid_argument(item);
+                }
+            }
+            catch (const std::exception &)
+            {
+                error = "invalid latency '" + item + "', expected a delay in ms or measured";
+                return false;
+            }
+        }
+        latencies.push_back(item);
+    }
+    return true;
+}
+
+bool readLatencySamples(const std::string &path, std::vector<double> &samples)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        return false;
+    }
+    std::string line;
+    while (std::getline(file, line))
+    {
+        // The first column holds the latency, a header or other columns are ignored
+        try
+        {
+            const double value = std::stod(line.substr(0, line.find(',')));
+            if (value >= 0)
+            {
+                samples.push_back(value);
+            }
+        }
+        catch (const std::exception &)
+        {
+        }
+    }
+    return !samples.empty();
+}
+
+std::vector<LatencyPoint> evaluateLatencies(const std::vector<SteeringOutput> &outputs,
+                                            const std::vector<GroundTruthSample> &groundTruth,
+                                            const std::vector<std::string> &latencies,
+                                            const std::vector<double> &samples, double threshold, int64_t toleranceUs)
+{
+    std::vector<std::string> labels(latencies);
+    if (!samples.empty())
+    {
+        labels.push_back(SAMPLES);
+    }
+    std::vector<LatencyPoint> points;
+    for (const std::string &label : labels)
+    {
+        // Same seed for every run, so that two runs on the same recording can be compared
+        std::mt19937 random(42);
+        std::uniform_int_distribution<size_t> pick(0, samples.empty() ? 0 : samples.size() - 1);
+        const bool fixed = (label != MEASURED && label != SAMPLES);
+        const double fixedMs = fixed ? std::stod(label) : 0.0;
+
+        LatencyPoint point{fixed ? label + "ms" : label, 0, 0, 0};
+        double latencySum = 0;
+        for (const SteeringOutput &output : outputs)
+        {
+            double latencyMs = fixedMs;
+            if (label == MEASURED)
+            {
+                latencyMs = output.processingMs;
+            }
+            else if (label == SAMPLES)
+            {
+                latencyMs = samples[pick(random)];
+            }
+            latencySum += latencyMs;
+
+            // Ground truth when the output reaches the car, matched like the replay matches frames
+            const int64_t effectUs = output.timeUs + static_cast<int64_t>(std::llround(latencyMs * 1000));
+            auto nearest = nearestSample(groundTruth.begin(), groundTruth.end(), effectUs, toleranceUs);
+            if (nearest == groundTruth.end())
+            {
+                continue;
+            }
+            const float truth = nearest->value;
+            // Determine difference between calculated and truth values, unless gsr is 0
+            if (std::fabs(truth) > 0)
+            {
+                point.totalValid++;
+                if (std::abs(output.steering - truth) <= threshold)
+                {
+                    point.withinRange++;
+                }
+            }
+        }
+        point.meanLatencyMs = outputs.empty() ? 0.0 : latencySum / static_cast<double>(outputs.size());
+        points.push_back(point);
+    }
+    return points;
+}
+
+void printLatencyCurve(std::ostream &out, const std::vector<LatencyPoint> &points)
+{
+    out << std::left << std::setw(12) << "latency" << std::right << std::setw(12) << "mean_ms" << std::setw(12) << "accuracy" << std::endl;
+    out << std::fixed << std::setprecision(2);
+    for (const LatencyPoint &point : points)
+    {
+        out << std::left << std::setw(12) << point.label << std::right << std::setw(12) << point.meanLatencyMs
+            << std::setw(11) << percentage(point.withinRange, point.totalValid) << "%" << std::endl;
+    }
+    out.unsetf(std::ios::fixed);
+}
+
+bool writeLatencyCurve(const std::string &path, const std::vector<LatencyPoint> &points)
+{
+    std::ofstream file(path);
+    if (!file.is_open())
+    {
+        return false;
+    }
+    file << "latency,mean_latency_ms,accuracy,valid_frames\n";
+    for (const LatencyPoint &point : points)
+    {
+        file << point.label << "," << point.meanLatencyMs << "," << percentage(point.withinRange, point.totalValid) << "," << point.totalValid << "\n";
+    }
+    return file.good();
+}
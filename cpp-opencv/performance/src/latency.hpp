@@ -0,0 +1,52 @@
+#ifndef LATENCY_HPP
+#define LATENCY_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Steering value computed for a frame and how long the computation took
+struct SteeringOutput
+{
+    int64_t timeUs;
+    double steering;
+    double processingMs;
+};
+
+struct GroundTruthSample
+{
+    int64_t timeUs;
+    float value;
+};
+
+// One point of the accuracy over latency curve
+struct LatencyPoint
+{
+    std::string label;
+    double meanLatencyMs;
+    int totalValid;
+    int withinRange;
+};
+
+// Delays to evaluate, a comma separated list of fixed delays in ms and/or "measured", which delays
+// every output by the processing time that was measured for it. samples (may be empty) adds a
+// point that draws the delay of every output from these measured latencies in ms.
+bool parseLatencies(const std::string &spec, std::vector<std::string> &latencies, std::string &error);
+
+// Read one latency in ms per line (a header line is skipped), e.g. a column exported from the car
+bool readLatencySamples(const std::string &path, std::vector<double> &samples);
+
+// Apply every output only after its delay and compare it with the ground truth at that time, the
+// nearest sample within toleranceUs as FrameJoiner matches frames, so that the 0 ms point
+// reproduces the accuracy of the replay. Outputs without such a sample are skipped. Outputs and
+// ground truth are expected in time order.
+std::vector<LatencyPoint> evaluateLatencies(const std::vector<SteeringOutput> &outputs,
+                                            const std::vector<GroundTruthSample> &groundTruth,
+                                            const std::vector<std::string> &latencies,
+                                            const std::vector<double> &samples, double threshold, int64_t toleranceUs);
+
+void printLatencyCurve(std::ostream &out, const std::vector<LatencyPoint> &points);
+bool writeLatencyCurve(const std::string &path, const std::vector<LatencyPoint> &points);
+
+#endif
@@ -0,0 +1,65 @@
+#include "pacing.hpp"
+#include <algorithm>
+#include <iomanip>
+#include <thread>
+
+PacedReplay::PacedReplay(double speed)
+    : speed_(speed), wallStart_(), firstSampleTimeUs_(0), frameTimeUs_(), busyMs_()
+{
+}
+
+void PacedReplay::start(int64_t firstSampleTimeUs)
+{
+    wallStart_ = std::chrono::steady_clock::now();
+    firstSampleTimeUs_ = firstSampleTimeUs;
+    frameTimeUs_.clear();
+    busyMs_.clear();
+}
+
+void PacedReplay::waitUntil(int64_t sampleTimeUs) const
+{
+    const double offsetUs = static_cast<double>(sampleTimeUs - firstSampleTimeUs_) / speed_;
+    std::this_thread::sleep_until(wallStart_ + std::chrono::microseconds(static_cast<int64_t>(offsetUs)));
+}
+
+void PacedReplay::addBusy(uint64_t frameId, int64_t sampleTimeUs, double ms)
+{
+    if (frameId >= busyMs_.size())
+    {
+        frameTimeUs_.resize(frameId + 1, sampleTimeUs);
+        busyMs_.resize(frameId + 1, 0.0);
+    }
+    frameTimeUs_[frameId] = sampleTimeUs;
+    busyMs_[frameId] += ms;
+}
+
+void PacedReplay::report(std::ostream &out, size_t worst) const
+{
+    // Overrun of a frame past the arrival of the next one, together with the frame's sample time
+    std::vector<std::pair<double, int64_t>> overruns;
+    double busyUntilMs = 0;
+    double maxLagMs = 0;
+    for (size_t i = 0; i + 1 < busyMs_.size(); i++)
+    {
+        const double arrivalMs = static_cast<double>(frameTimeUs_[i] - firstSampleTimeUs_) / speed_ / 1000.0;
+        const double nextArrivalMs = static_cast<double>(frameTimeUs_[i + 1] - firstSampleTimeUs_) / speed_ / 1000.0;
+        const double startMs = std::max(arrivalMs, busyUntilMs);
+        busyUntilMs = startMs + busyMs_[i];
+        maxLagMs = std::max(maxLagMs, busyUntilMs - arrivalMs);
+        if (busyUntilMs > nextArrivalMs)
+        {
+            overruns.emplace_back(busyUntilMs - nextArrivalMs, frameTimeUs_[i]);
+        }
+    }
+    const size_t frames = busyMs_.empty() ? 0 : busyMs_.size() - 1;
+    out << "Paced replay at " << speed_ << "x: " << overruns.size() << " of " << frames << " frames missed their deadline ("
+        << std::fixed << std::setprecision(2) << (frames > 0 ? 100.0 * overruns.size() / frames : 0.0)
+        << "%), max latency from arrival to result " << maxLagMs << " ms" << std::endl;
+    std::sort(overruns.begin(), overruns.end(), [](const std::pair<double, int64_t> &a, const std::pair<double, int64_t> &b)
+              { return a.first > b.first; });
+    for (size_t i = 0; i < std::min(worst, overruns.size()); i++)
+    {
+        out << "  overrun " << std::setw(8) << overruns[i].first << " ms at sample time " << overruns[i].second << std::endl;
+    }
+    out.unsetf(std::ios::fixed);
+}
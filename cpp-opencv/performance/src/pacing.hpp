@@ -0,0 +1,35 @@
+#ifndef PACING_HPP
+#define PACING_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+// Delivers the recording at its recorded intervals, optionally sped up, and accounts for the
+// frames whose processing did not finish before the next frame arrived. Frames are handled
+// one after another like on the car: a frame that arrives while the previous one is still
+// being processed has to wait, and its processing counts from when it could start.
+class PacedReplay
+{
+public:
+    explicit PacedReplay(double speed);
+
+    // Start a repetition, the envelope with firstSampleTimeUs is delivered right away
+    void start(int64_t firstSampleTimeUs);
+    // Sleep until the envelope with this sample time is due
+    void waitUntil(int64_t sampleTimeUs) const;
+    // Add decoding or processing time of a frame, frame ids count up from 0 in arrival order
+    void addBusy(uint64_t frameId, int64_t sampleTimeUs, double ms);
+    // Print deadline misses and the worst overruns of the current repetition
+    void report(std::ostream &out, size_t worst) const;
+
+private:
+    double speed_;
+    std::chrono::steady_clock::time_point wallStart_;
+    int64_t firstSampleTimeUs_;
+    std::vector<int64_t> frameTimeUs_;
+    std::vector<double> busyMs_;
+};
+
+#endif
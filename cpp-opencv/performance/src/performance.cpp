@@ -10,175 +10,578 @@
 #include <sstream>
 #include <string>
 #include <iomanip>
-#include <libyuv.h>
-#include <wels/codec_api.h>
+#include <map>
 #include "steering.hpp"
+#include "decimation.hpp"
+#include "detectioncache.hpp"
+#include "equivalence.hpp"
+#include "flightreplay.hpp"
+#include "perfcounters.hpp"
+#include "latency.hpp"
+#include "pacing.hpp"
+#include "recording.hpp"
+#include "replay.hpp"
+#include "results.hpp"
+#include "timing.hpp"
+#include "variants.hpp"
 
 float THRESHOLD = 0.09;
-constexpr const bool AUTOREWIND{false};
-constexpr const bool THREADING{false};
+
+namespace
+{
+    typedef std::map<std::string, std::string> Arguments;
+
+    void printUsage(const std::string &program)
+    {
+        std::cerr << program << " requires a recording file to process." << std::endl;
+        std::cerr << "Usage:   " << program << " --rec=<Recording.rec> [--output=<file.csv>] [--variants=<engine>[:<config>],...] [--results=<file.bin> [--plot=<file.csv>]] [--detection-cache=<dir> [--steering-only]] [--start=<s>] [--memory-budget=<MB>] [--match-tolerance=<ms>] [--decimate=<n|hz>,...] [--latency=<ms|measured>,... [--latency-samples=<file>] [--latency-curve=<file.csv>]] [--pace=<speed> [--worst-overruns=<n>]] [--repeat=<n>] [--timing=<summary.csv>] [--baseline=<summary.csv>] [--max-slowdown=<percent>] [--alpha=<p>] [--profile] [--counters=<file.csv>] [--equivalence=<file.csv> [--tolerance=<steering>,<px>,<mask>]] [--scene-reuse=<threshold>[,<n>]] [--trace=<file.json>] [--verbose]" << std::endl;
+        std::cerr << "         " << program << " --timing=<summary.csv> --baseline=<summary.csv> [--max-slowdown=<percent>] [--alpha=<p>]" << std::endl;
+        std::cerr << "         " << program << " --compare=<current.bin> --against=<previous.bin> [--join-tolerance=<us>] [--joined=<file.csv>] [--plot-points=<n>]" << std::endl;
+        std::cerr << "         " << program << " --dump=<flight-*.bin> [--variants=<engine>[:<config>],...] [--repeat=<n>] [--profile]" << std::endl;
+        std::cerr << "         --variants:     steering engines (and config files) to run side by side on every decoded frame (default contour, also fastpath, histogram and labels)" << std::endl;
+        std::cerr << "         --results:      binary columnar file with timestamp, ground truth, steering and stage timings" << std::endl;
+        std::cerr << "         --detection-cache: directory for the per-frame cone detections, written on every full replay" << std::endl;
+        std::cerr << "         --steering-only: re-run only the steering math on the cached detections instead of decoding the recording" << std::endl;
+        std::cerr << "         --start:        skip the first s seconds of the recording, uses the <recording>.idx index" << std::endl;
+        std::cerr << "         --memory-budget: megabytes of the recording kept mapped behind the replay position (default 256, 0 for unlimited)" << std::endl;
+        std::cerr << "         --match-tolerance: frames are paired with the nearest ground truth within this many ms, others are dropped (default 50)" << std::endl;
+        std::cerr << "         --decimate:     also process only every nth frame (e.g. 2) or at a rate (e.g. 15hz) and hold the steering in between," << std::endl;
+        std::cerr << "                         reports accuracy and CPU time of every rate for the first variant" << std::endl;
+        std::cerr << "         --latency:      apply every steering output only after this delay and compare it with the ground truth at that time," << std::endl;
+        std::cerr << "                         matched within --match-tolerance like the replay, so 0 reproduces its accuracy," << std::endl;
+        std::cerr << "                         measured uses the processing time of every frame, reports accuracy over latency" << std::endl;
+        std::cerr << "         --latency-samples: also draw the delays from these measured latencies (one value in ms per line)" << std::endl;
+        std::cerr << "         --latency-curve: write the accuracy over latency as CSV" << std::endl;
+        std::cerr << "         --pace:         deliver the frames at their recorded intervals, sped up by this factor, and report the" << std::endl;
+        std::cerr << "                         frames that were not processed before the next one arrived (1 for real time)." << std::endl;
+        std::cerr << "                         Frames without ground truth are processed by the first variant for timing only, on a copy of" << std::endl;
+        std::cerr << "                         its state, so the steering of every variant matches an unpaced replay" << std::endl;
+        std::cerr << "         --worst-overruns: number of worst deadline overruns to list with --pace (default 5)" << std::endl;
+        std::cerr << "         --repeat:       replay the recording n times to collect timing statistics (default 1)" << std::endl;
+        std::cerr << "         --timing:       file for the per-stage and frames-per-second timing summary" << std::endl;
+        std::cerr << "         --baseline:     timing summary of a previous run, exits with 2 on a significant slowdown or if fps or frame_ms is missing" << std::endl;
+        std::cerr << "         --max-slowdown: allowed slowdown in percent, fails only if the run is significantly slower than the baseline plus this (default 10)" << std::endl;
+        std::cerr << "         --alpha:        significance level of the t-test (default 0.05)" << std::endl;
+        std::cerr << "         --equivalence:  also run every variant next to the frozen reference pipeline and write the per-frame differences" << std::endl;
+        std::cerr << "                         in masks, closest centroids and steering as CSV, exits with 3 if a frame is outside the tolerance" << std::endl;
+        std::cerr << "         --tolerance:    largest steering, centroid (px) and mask (fraction of pixels) difference (default 0.005,2,0.001)" << std::endl;
+        std::cerr << "         --scene-reuse:  reuse the previous detection while no block of the frame signature changed by the threshold" << std::endl;
+        std::cerr << "                         or more (intensity levels, e.g. 2), at most n frames in a row (default 10)" << std::endl;
+        std::cerr << "         --trace:        write the spans of every stage and thread as Chrome trace JSON (chrome://tracing, ui.perfetto.dev)," << std::endl;
+        std::cerr << "                         needs a build with -DENABLE_TRACING=ON" << std::endl;
+        std::cerr << "         --compare:      join two result files by timestamp and report accuracy and latency deltas" << std::endl;
+        std::cerr << "         --joined:       write the joined ground truth and steering of both runs as CSV" << std::endl;
+        std::cerr << "         --plot:         write the ground truth and steering from --results as CSV for plotting" << std::endl;
+        std::cerr << "         --dump:         re-run the frames of a flight recorder dump from main and compare the frame times and steering with the car," << std::endl;
+        std::cerr << "                         every frame runs --repeat times (default 5) and the median is reported. The variants (default the engine" << std::endl;
+        std::cerr << "                         of the car) start from the state of the car and use its configuration unless they have a config file" << std::endl;
+        std::cerr << "         --profile:      read the performance counters (cycles, instructions, cache and branch misses, page faults) of every" << std::endl;
+        std::cerr << "                         stage of the first variant and report them per frame with CPU time and context switches," << std::endl;
+        std::cerr << "                         with --dump also list the per-stage times of the car and the first variant for every frame" << std::endl;
+        std::cerr << "         --counters:     also write the per-stage counters of every frame as CSV" << std::endl;
+        std::cerr << "         --plot-points:  downsample --plot and --joined to n >= 3 rows, 0 keeps every row (default 2000)" << std::endl;
+        std::cerr << "Example: " << program << " --rec=myRecording.rec" << std::endl;
+    }
+
+    // Join two binary result files on their timestamps and report the differences
+    int compareResultFiles(Arguments &commandlineArguments, size_t plotPoints)
+    {
+        const int64_t tolerance = (commandlineArguments.count("join-tolerance") != 0) ? std::stoll(commandlineArguments["join-tolerance"]) : 0;
+        const std::string joined = (commandlineArguments.count("joined") != 0) ? commandlineArguments["joined"] : "";
+        return compareResults(std::cout, commandlineArguments["compare"], commandlineArguments["against"], tolerance, THRESHOLD, joined, plotPoints) ? 0 : 1;
+    }
+
+    // Re-run the frames a flight recorder dumped on the car
+    int replayDump(Arguments &commandlineArguments)
+    {
+        FlightDump dump{"", "", initialSteeringState(), std::vector<FlightFrame>()};
+        if (!readFlightDump(commandlineArguments["dump"], dump) || dump.frames.empty())
+        {
+            std::cerr << "Error: Could not read flight recorder dump " << commandlineArguments["dump"] << std::endl;
+            return 1;
+        }
+        // Without --variants the dump is replayed with the engine of the car
+        std::vector<Variant> variants;
+        std::string variantError;
+        if (!parseVariants((commandlineArguments.count("variants") != 0) ? commandlineArguments["variants"] : dump.engine, variants, variantError))
+        {
+            std::cerr << "Error: " << variantError << std::endl;
+            return 1;
+        }
+        const int repetitions = (commandlineArguments.count("repeat") != 0) ? std::max(1, std::stoi(commandlineArguments["repeat"])) : 5;
+        replayFlightDump(std::cout, commandlineArguments["dump"], dump, variants, repetitions, commandlineArguments.count("profile") != 0);
+        return 0;
+    }
+
+    // Compare an existing timing summary against the baseline, exits with 2 on a slowdown
+    int compareTimingFiles(Arguments &commandlineArguments, double maxSlowdown, double alpha)
+    {
+        std::map<std::string, std::vector<double>> current, baseline;
+        if (!readTimingSummary(commandlineArguments["timing"], current) ||
+            !readTimingSummary(commandlineArguments["baseline"], baseline))
+        {
+            std::cerr << "Error: Could not read timing summaries" << std::endl;
+            return 1;
+        }
+        return compareTimingSummaries(std::cout, baseline, current, maxSlowdown, alpha) ? 0 : 2;
+    }
+
+    // The steering of the first variant, once alone and once with the timestamp and ground truth
+    bool openCsvOutputs(Arguments &commandlineArguments, ReplayOutputs &outputs)
+    {
+        // Add output file path handling
+        std::string outputPath = "output.csv";  // Default
+        std::string currentOutputPath = "current_output.csv";
+        if (commandlineArguments.count("output") > 0) {
+            outputPath = commandlineArguments["output"];
+            // Insert "_current" before the file extension
+            size_t dotPos = outputPath.find_last_of(".");
+            if (dotPos != std::string::npos) {
+                currentOutputPath = outputPath.substr(0, dotPos) + "_current" + outputPath.substr(dotPos);
+            } else {
+                currentOutputPath = outputPath + "_current";
+            }
+        } else {
+            currentOutputPath = "output_current.csv";
+        }
+        // Open file with error checking
+        outputs.computedFile.open(outputPath);
+        if (!outputs.computedFile.is_open()) {
+            std::cerr << "Error: Could not open output file at " << outputPath << std::endl;
+            return false;
+        }
+        outputs.computedFile << "prevGroundSteering\n";
+
+        outputs.computedCurrent.open(currentOutputPath);
+        if (!outputs.computedCurrent.is_open()) {
+            std::cerr << "Error: Could not open output file at " << currentOutputPath << std::endl;
+            return false;
+        }
+        outputs.computedCurrent << "timestamp,groundTruth,groundSteering\n";
+        return true;
+    }
+
+    // Optional decimation study, every rate has its own steering state and only sees the frames it processes
+    bool setupDecimation(Arguments &commandlineArguments, const std::vector<Variant> &variants, ReplayOutputs &outputs)
+    {
+        std::string error;
+        if (commandlineArguments.count("decimate") != 0 &&
+            !parseDecimation(commandlineArguments["decimate"], variants[0].engine, variants[0].config, outputs.decimation, error))
+        {
+            std::cerr << "Error: " << error << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // Optional latency injection, the outputs of the first variant and all ground truth samples of the
+    // first repetition are kept and delayed afterwards
+    bool setupLatency(Arguments &commandlineArguments, std::vector<std::string> &latencies, std::vector<double> &latencySamples,
+                      ReplayOutputs &outputs)
+    {
+        std::string error;
+        if (commandlineArguments.count("latency") != 0 && !parseLatencies(commandlineArguments["latency"], latencies, error))
+        {
+            std::cerr << "Error: " << error << std::endl;
+            return false;
+        }
+        if (commandlineArguments.count("latency-samples") != 0 && !readLatencySamples(commandlineArguments["latency-samples"], latencySamples))
+        {
+            std::cerr << "Error: Could not read latency samples from " << commandlineArguments["latency-samples"] << std::endl;
+            return false;
+        }
+        outputs.injectLatency = !latencies.empty() || !latencySamples.empty();
+        return true;
+    }
+
+    // Optional real-time pacing with deadline accounting
+    bool setupPacing(Arguments &commandlineArguments, ReplayOutputs &outputs)
+    {
+        if (commandlineArguments.count("pace") != 0)
+        {
+            const double speed = std::stod(commandlineArguments["pace"]);
+            if (speed <= 0)
+            {
+                std::cerr << "Error: --pace needs a speed above 0" << std::endl;
+                return false;
+            }
+            outputs.pacer.reset(new PacedReplay(speed));
+        }
+        outputs.worstOverruns = (commandlineArguments.count("worst-overruns") != 0) ? std::stoul(commandlineArguments["worst-overruns"]) : 5;
+        return true;
+    }
+
+    // Optional performance counters of every stage of the first variant, optionally per frame as CSV
+    bool setupProfiling(Arguments &commandlineArguments, std::vector<Variant> &variants, ReplayOutputs &outputs)
+    {
+        outputs.profile = (commandlineArguments.count("profile") != 0) || (commandlineArguments.count("counters") != 0);
+        if (outputs.profile)
+        {
+            variants[0].counters = &outputs.frameCounters;
+        }
+        if (commandlineArguments.count("counters") != 0)
+        {
+            outputs.countersFile.open(commandlineArguments["counters"]);
+            if (!outputs.countersFile.is_open())
+            {
+                std::cerr << "Error: Could not open counter file at " << commandlineArguments["counters"] << std::endl;
+                return false;
+            }
+            writeCounterHeader(outputs.countersFile);
+        }
+        return true;
+    }
+
+    // Optional reuse of the detection on unchanged frames, for every variant
+    bool setupSceneReuse(Arguments &commandlineArguments, std::vector<Variant> &variants)
+    {
+        if (commandlineArguments.count("scene-reuse") != 0)
+        {
+            std::istringstream spec(commandlineArguments["scene-reuse"]);
+            double threshold = 0;
+            int refreshFrames = 10;
+            char separator = ',';
+            if (!(spec >> threshold) || (!spec.eof() && (!(spec >> separator >> refreshFrames) || separator != ',')))
+            {
+                std::cerr << "Error: --scene-reuse needs <threshold>[,<refresh frames>]" << std::endl;
+                return false;
+            }
+            for (Variant &variant : variants)
+            {
+                variant.sceneCache = std::make_shared<SceneCache>(threshold, refreshFrames);
+            }
+        }
+        return true;
+    }
+
+    // Optional equivalence check of every variant against the frozen reference pipeline
+    bool setupEquivalence(Arguments &commandlineArguments, const std::vector<Variant> &variants, ReplayOutputs &outputs)
+    {
+        if (commandlineArguments.count("equivalence") != 0)
+        {
+            EquivalenceTolerance tolerance = defaultEquivalenceTolerance();
+            if (commandlineArguments.count("tolerance") != 0)
+            {
+                std::istringstream spec(commandlineArguments["tolerance"]);
+                char first = ',', second = ',';
+                if (!(spec >> tolerance.steering >> first >> tolerance.centroidPx >> second >> tolerance.maskFraction) || first != ',' || second != ',')
+                {
+                    std::cerr << "Error: --tolerance needs <steering>,<centroid px>,<mask fraction>" << std::endl;
+                    return false;
+                }
+            }
+            for (const Variant &variant : variants)
+            {
+                outputs.equivalence.push_back(EquivalenceCheck(variant.engineName, variant.config, tolerance));
+            }
+            outputs.equivalenceFile.open(commandlineArguments["equivalence"]);
+            if (!outputs.equivalenceFile.is_open())
+            {
+                std::cerr << "Error: Could not open equivalence file at " << commandlineArguments["equivalence"] << std::endl;
+                return false;
+            }
+            writeEquivalenceHeader(outputs.equivalenceFile);
+        }
+        return true;
+    }
+
+    // Optional binary result stream, one row per processed frame and columns for every variant
+    bool setupResults(Arguments &commandlineArguments, const std::vector<Variant> &variants, ReplayOutputs &outputs)
+    {
+        const std::vector<std::string> columns = resultColumns(variants);
+        outputs.resultRow.assign(columns.size(), 0.0);
+        if (commandlineArguments.count("results") != 0)
+        {
+            outputs.results.reset(new ResultWriter(commandlineArguments["results"], columns));
+            if (!outputs.results->isOpen())
+            {
+                std::cerr << "Error: Could not open result file at " << commandlineArguments["results"] << std::endl;
+                return false;
+            }
+        }
+        else if (commandlineArguments.count("plot") != 0)
+        {
+            std::cerr << "Error: --plot needs --results, the plot is made from the full resolution result file" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // Cone detections are cached per recording and detection config, the steering-only mode replays
+    // them through the steering math of every variant
+    bool setupDetectionCache(Arguments &commandlineArguments, const std::string &recFile, bool steeringOnly,
+                             const std::vector<Variant> &variants, ReplayOutputs &outputs,
+                             std::unique_ptr<DetectionReader> &cachedDetections)
+    {
+        const uint64_t detectionHash = detectionConfigHash(variants[0].engineName, variants[0].config);
+        const std::string detectionPath = (commandlineArguments.count("detection-cache") != 0)
+                                              ? detectionCachePath(commandlineArguments["detection-cache"], recFile, detectionHash)
+                                              : "";
+        if (steeringOnly)
+        {
+            if (detectionPath.empty())
+            {
+                std::cerr << "Error: --steering-only needs --detection-cache" << std::endl;
+                return false;
+            }
+            if (!outputs.decimation.empty() || outputs.injectLatency || outputs.pacer || outputs.profile || !outputs.equivalence.empty())
+            {
+                std::cerr << "Error: --decimate, --latency, --pace, --profile and --equivalence need the recording and cannot be combined with --steering-only" << std::endl;
+                return false;
+            }
+            for (const Variant &variant : variants)
+            {
+                if (detectionConfigHash(variant.engineName, variant.config) != detectionHash)
+                {
+                    std::cerr << "Error: Variant " << variant.label << " detects cones differently than " << variants[0].label
+                              << ", it needs a full replay" << std::endl;
+                    return false;
+                }
+            }
+            cachedDetections.reset(new DetectionReader(detectionPath));
+            if (!cachedDetections->isOpen() || cachedDetections->configHash() != detectionHash ||
+                cachedDetections->recordingBytes() != fileSize(recFile))
+            {
+                std::cerr << "Error: No valid detection cache at " << detectionPath << ", replay once without --steering-only" << std::endl;
+                return false;
+            }
+        }
+        else if (!detectionPath.empty())
+        {
+            outputs.detections.reset(new DetectionWriter(detectionPath, detectionHash, fileSize(recFile)));
+            if (!outputs.detections->isOpen())
+            {
+                std::cerr << "Error: Could not open detection cache at " << detectionPath << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Accuracy of algorithm compared to truth steering values, for every variant
+    void printAccuracy(const std::vector<Variant> &variants)
+    {
+        for (const Variant &variant : variants)
+        {
+            const double acc = (variant.totalValid > 0) ? (static_cast<double>(variant.withinRange) / variant.totalValid) * 100.0 : 0.0;
+            if (variants.size() == 1)
+            {
+                std::cout << "Accuracy: " << acc << "%" << std::endl;
+            }
+            else
+            {
+                std::cout << "Accuracy " << variant.label << ": " << acc << "%" << std::endl;
+            }
+            if (variant.sceneCache)
+            {
+                std::cout << "Scene reuse " << variant.label << ": " << variant.sceneCache->reusedFrames() << " of " << variant.sceneCache->frames()
+                          << " frames reused the previous detection" << std::endl;
+            }
+        }
+    }
+
+    // Delay the kept outputs and report the accuracy over latency
+    bool reportLatency(Arguments &commandlineArguments, const std::vector<std::string> &latencies, const std::vector<double> &latencySamples,
+                       double matchToleranceMs, ReplayOutputs &outputs)
+    {
+        // The recording may store ground truth out of order, the joiner sorts its own copy
+        std::stable_sort(outputs.latencyTruth.begin(), outputs.latencyTruth.end(), [](const GroundTruthSample &a, const GroundTruthSample &b)
+                         { return a.timeUs < b.timeUs; });
+        const std::vector<LatencyPoint> curve = evaluateLatencies(outputs.latencyOutputs, outputs.latencyTruth, latencies, latencySamples, THRESHOLD,
+                                                                  static_cast<int64_t>(matchToleranceMs * 1000));
+        printLatencyCurve(std::cout, curve);
+        if (commandlineArguments.count("latency-curve") != 0 && !writeLatencyCurve(commandlineArguments["latency-curve"], curve))
+        {
+            std::cerr << "Error: Could not write latency curve to " << commandlineArguments["latency-curve"] << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // Write the timing summary and check it against the baseline, returns the exit code
+    int checkTiming(Arguments &commandlineArguments, const TimingRecorder &timingRecorder, double maxSlowdown, double alpha)
+    {
+        if (commandlineArguments.count("timing") != 0 && !writeTimingSummary(commandlineArguments["timing"], timingRecorder.metrics()))
+        {
+            std::cerr << "Error: Could not write timing summary to " << commandlineArguments["timing"] << std::endl;
+            return 1;
+        }
+        if (commandlineArguments.count("baseline") != 0)
+        {
+            std::map<std::string, std::vector<double>> baseline;
+            if (!readTimingSummary(commandlineArguments["baseline"], baseline))
+            {
+                std::cerr << "Error: Could not read baseline timing summary " << commandlineArguments["baseline"] << std::endl;
+                return 1;
+            }
+            if (!compareTimingSummaries(std::cout, baseline, timingRecorder.metrics(), maxSlowdown, alpha))
+            {
+                std::cerr << "Error: Significant slowdown of more than " << maxSlowdown << "% against the baseline, or a gated metric is missing" << std::endl;
+                return 2;
+            }
+        }
+        return 0;
+    }
+}
 
 int32_t main(int32_t argc, char **argv)
 {
     auto commandlineArguments = cluon::getCommandlineArguments(argc, argv);
     // parse recording file path in arguments and --verbose flag
-    if (commandlineArguments.count("rec") == 0)
+    const double maxSlowdown = (commandlineArguments.count("max-slowdown") != 0) ? std::stod(commandlineArguments["max-slowdown"]) : 10.0;
+    const double alpha = (commandlineArguments.count("alpha") != 0) ? std::stod(commandlineArguments["alpha"]) : 0.05;
+    const size_t plotPoints = (commandlineArguments.count("plot-points") != 0) ? std::stoul(commandlineArguments["plot-points"]) : 2000;
+    // The first and the last row take two points, downsampling needs at least one more
+    if (plotPoints == 1 || plotPoints == 2)
     {
-        std::cerr << argv[0] << " requires a recording file to process." << std::endl;
-        std::cerr << "Usage:   " << argv[0] << " --rec=<Recording.rec> [--verbose]" << std::endl;
-        std::cerr << "Example: " << argv[0] << " --rec=myRecording.rec" << std::endl;
+        std::cerr << "Error: --plot-points must be 0 or at least 3" << std::endl;
         return 1;
     }
-
-    // Add output file path handling
-    std::string outputPath = "output.csv";  // Default
-    std::string currentOutputPath = "current_output.csv";
-    if (commandlineArguments.count("output") > 0) {
-        outputPath = commandlineArguments["output"];
-        // Insert "_current" before the file extension
-        size_t dotPos = outputPath.find_last_of(".");
-        if (dotPos != std::string::npos) {
-            currentOutputPath = outputPath.substr(0, dotPos) + "_current" + outputPath.substr(dotPos);
-        } else {
-            currentOutputPath = outputPath + "_current";
+    if (commandlineArguments.count("rec") == 0)
+    {
+        if (commandlineArguments.count("compare") != 0 && commandlineArguments.count("against") != 0)
+        {
+            return compareResultFiles(commandlineArguments, plotPoints);
         }
-    } else {
-        currentOutputPath = "output_current.csv";
+        if (commandlineArguments.count("dump") != 0)
+        {
+            return replayDump(commandlineArguments);
+        }
+        if (commandlineArguments.count("timing") != 0 && commandlineArguments.count("baseline") != 0)
+        {
+            return compareTimingFiles(commandlineArguments, maxSlowdown, alpha);
+        }
+        printUsage(argv[0]);
+        return 1;
     }
-    // Open file with error checking
-    std::ofstream computedFile(outputPath);
-    if (!computedFile.is_open()) {
-        std::cerr << "Error: Could not open output file at " << outputPath << std::endl;
+    // Fail before the replay if the trace cannot be written at the end
+    if (commandlineArguments.count("trace") != 0 && !checkTraceSupport(commandlineArguments["trace"]))
+    {
         return 1;
     }
-    computedFile << "prevGroundSteering\n";
 
-    std::ofstream computedCurrent(currentOutputPath);
-     
-    if (!computedCurrent.is_open()) {
-        std::cerr << "Error: Could not open output file at " << currentOutputPath << std::endl;
+    ReplayOutputs outputs;
+    if (!openCsvOutputs(commandlineArguments, outputs))
+    {
         return 1;
-    } 
-    computedCurrent << "timestamp,groundTruth,groundSteering\n";
+    }
 
     const std::string recFile = commandlineArguments["rec"];
-    bool verbose = (commandlineArguments.count("verbose") != 0);
-    cluon::Player player(recFile, AUTOREWIND, THREADING); // pass recording file and other parameters to Player object
-    opendlv::proxy::GroundSteeringRequest gsr;            // variable to store gsr message
-    opendlv::proxy::ImageReading img;                     // variable to store imagereading message
-    cluon::data::TimeStamp ts;                            // TimeStamp object to store timestamp
-    double calculatedSteering;                            // The steering calculated using our algorithm
-    int64_t ts_ms;                                        // variable to store timestamp in millieseconds
-    int failures = 0;                                     // counts frames that failed to decode / process
-    bool hasAngle = false;                                // variable to keep track if image frame has equivalent gsr data
-    int totalValid = 0;                                   // Amount of valid ground truth values
-    int withinRange = 0;                                  // Amount of calculated steering angles within range
-    float acc = 0;                                        // Accuracy of algorithm compared to truth steering values
-    
-    // Initialize the decoder
-    ISVCDecoder *decoder = nullptr;
-    WelsCreateDecoder(&decoder);
-    if (!decoder)
-    {
-        std::cerr << "Failed to create decoder" << std::endl;
+    const size_t memoryBudgetMb = (commandlineArguments.count("memory-budget") != 0) ? std::stoul(commandlineArguments["memory-budget"]) : 256;
+    const ReplaySettings settings{
+        (commandlineArguments.count("repeat") != 0) ? std::max(1, std::stoi(commandlineArguments["repeat"])) : 1,
+        (commandlineArguments.count("start") != 0) ? std::stod(commandlineArguments["start"]) : 0.0,
+        (commandlineArguments.count("match-tolerance") != 0) ? std::stod(commandlineArguments["match-tolerance"]) : 50.0,
+        THRESHOLD,
+        commandlineArguments.count("verbose") != 0};
+    TimingRecorder timingRecorder;                        // per-stage timings of every repetition
+
+    // Steering variants that all get the same decoded frames, the first one is the primary variant
+    // that the CSV files, the accuracy and the timing summary refer to
+    std::vector<Variant> variants;
+    std::string variantError;
+    if (!parseVariants((commandlineArguments.count("variants") != 0) ? commandlineArguments["variants"] : "contour", variants, variantError))
+    {
+        std::cerr << "Error: " << variantError << std::endl;
         return 1;
     }
 
-    SDecodingParam decoding_param;
-    memset(&decoding_param, 0, sizeof(SDecodingParam));
-    decoding_param.eEcActiveIdc = ERROR_CON_DISABLE;
-    decoding_param.bParseOnly = false;
-    decoding_param.sVideoProperty.eVideoBsType = VIDEO_BITSTREAM_DEFAULT;
+    std::vector<std::string> latencies;
+    std::vector<double> latencySamples;
+    if (!setupDecimation(commandlineArguments, variants, outputs) ||
+        !setupLatency(commandlineArguments, latencies, latencySamples, outputs) ||
+        !setupPacing(commandlineArguments, outputs) ||
+        !setupProfiling(commandlineArguments, variants, outputs))
+    {
+        return 1;
+    }
+    const ResourceUsage usageStart = resourceUsage();
+    if (!setupSceneReuse(commandlineArguments, variants) ||
+        !setupEquivalence(commandlineArguments, variants, outputs) ||
+        !setupResults(commandlineArguments, variants, outputs))
+    {
+        return 1;
+    }
+    const bool steeringOnly = (commandlineArguments.count("steering-only") != 0);
+    std::unique_ptr<DetectionReader> cachedDetections;
+    if (!setupDetectionCache(commandlineArguments, recFile, steeringOnly, variants, outputs, cachedDetections))
+    {
+        return 1;
+    }
 
-    if (cmResultSuccess != decoder->Initialize(&decoding_param))
+    if (steeringOnly)
+    {
+        replayDetections(*cachedDetections, settings, variants, outputs, timingRecorder);
+    }
+    else
+    {
+        // The recording is mapped into memory once and replayed in sample time order like cluon::Player does,
+        // its envelope index is reused from <recording>.idx when the recording did not change
+        RecordingReader recording(recFile);
+        if (!recording.isOpen())
+        {
+            std::cerr << "Error: Could not open recording " << recFile << std::endl;
+            return 1;
+        }
+        // Only images and ground truth are replayed, the payloads of the other sensors are never read
+        recording.setTypeFilter({1055, 1090});
+        recording.setMemoryBudget(memoryBudgetMb * 1024 * 1024);
+        if (!replayRecording(recording, settings, variants, outputs, timingRecorder))
+        {
+            return 1;
+        }
+    }
+    outputs.computedFile.close();
+    if (commandlineArguments.count("trace") != 0 && !writeTrace(commandlineArguments["trace"]))
     {
-        std::cerr << "Failed to initialize decoder" << std::endl;
         return 1;
     }
-   
-    // loop that ends when .rec file has no more data
-    while (player.hasMoreData())
+    if (outputs.detections)
     {
-        auto next = player.getNextEnvelopeToBeReplayed(); // get next envelope of .rec file
-        if (next.first)
+        outputs.detections->close();
+    }
+    if (outputs.results)
+    {
+        outputs.results->close();
+        if (commandlineArguments.count("plot") != 0 &&
+            !writePlotSeries(commandlineArguments["results"], commandlineArguments["plot"], plotPoints))
         {
-            cluon::data::Envelope envelope = next.second; // store current envelope
-            // if datatype is ImageReading (see opendlv-standard-message-set)
-            if (envelope.dataType() == 1055)
-            {
-                if (hasAngle)
-                {
-                    img = cluon::extractMessage<opendlv::proxy::ImageReading>(std::move(envelope));
-                    // Note: The following segment is code taken, but appropriated, from here ->
-                    // https://github.com/chalmers-revere/opendlv-video-h264-decoder/blob/master/src/opendlv-video-h264-decoder.cpp
-                    // Check if the image encoding is H264.
-                    if ("h264" == img.fourcc())
-                    {
-                        const uint32_t WIDTH = img.width();
-                        const uint32_t HEIGHT = img.height();
-                        // Prepare the buffer for decoding.
-                        uint8_t *yuvData[3]; // Pointers to Y, U, and V planes.
-                        SBufferInfo bufferInfo;
-                        memset(&bufferInfo, 0, sizeof(SBufferInfo));
-                        // Retrieve the H264 data from the message.
-                        std::string data{img.data()};
-                        const uint32_t LEN = static_cast<uint32_t>(data.size());
-                        // Decode the H264 frame.
-                        if (0 != decoder->DecodeFrame2(reinterpret_cast<const unsigned char *>(data.c_str()), LEN, yuvData, &bufferInfo))
-                        {
-                            failures++;
-                        }
-                        else
-                        {
-                            // If the decoding is successful and the buffer is valid.
-                            if (1 == bufferInfo.iBufferStatus)
-                            {
-                                // Convert the YUV data to a cv::Mat in BGR format.
-                                cv::Mat bgrImage(HEIGHT, WIDTH, CV_8UC3);
-                                libyuv::I420ToRGB24(
-                                    yuvData[0], bufferInfo.UsrData.sSystemBuffer.iStride[0], // Y plane.
-                                    yuvData[1], bufferInfo.UsrData.sSystemBuffer.iStride[1], // U plane.
-                                    yuvData[2], bufferInfo.UsrData.sSystemBuffer.iStride[1], // V plane.
-                                    bgrImage.data, WIDTH * 3,                                // Destination (BGR format).
-                                    WIDTH, HEIGHT                                            // Dimensions.
-                                );
-                                // Process frame to calculate steering
-                                calculatedSteering = processFrame(bgrImage, verbose);
-                                
-                                // Determine difference between calculated and truth values, unless gsr is 0
-                                if (gsr.groundSteering() != 0)
-                                {
-                                    totalValid++;
-                                    if (std::abs(calculatedSteering - gsr.groundSteering()) <= THRESHOLD)
-                                    {
-                                        withinRange++;
-                                    }
-                                }
-                                // Print output
-                                if (totalValid > 0){
-                                    acc = ((double)withinRange / totalValid) * 100.0;
-                                }
-                                computedFile << calculatedSteering << "\n";
-                                computedCurrent << ts_ms << "," << gsr.groundSteering() << "," << calculatedSteering << "\n";
-                                hasAngle = false;
-                            }
-                        }
-                    }
-                }
-            }
-            // if datatype is GroundSteeringRequest (see: opendlv-standard-message-set)
-            else if (envelope.dataType() == 1090)
-            {
-                ts = envelope.sampleTimeStamp();
-                ts_ms = cluon::time::toMicroseconds(ts); // take timestamp
-                
-                // if corresponding image exists with timestamp
-                gsr = cluon::extractMessage<opendlv::proxy::GroundSteeringRequest>(std::move(envelope));
-                hasAngle = true;
-            }
+            std::cerr << "Error: Could not write plot series to " << commandlineArguments["plot"] << std::endl;
+            return 1;
         }
     }
-    computedFile.close();
-    std::cout << "Accuracy: " << acc << "%" << std::endl;
+    printAccuracy(variants);
+
+    if (!outputs.decimation.empty())
+    {
+        printDecimation(std::cout, outputs.decimation);
+    }
+    if (outputs.injectLatency && !reportLatency(commandlineArguments, latencies, latencySamples, settings.matchToleranceMs, outputs))
+    {
+        return 1;
+    }
+
+    // Report the timing statistics and optionally check them against a baseline
+    printTimingSummary(std::cout, timingRecorder.metrics());
+    if (outputs.profile)
+    {
+        outputs.counterSummary.print(std::cout, usageSince(usageStart, resourceUsage()));
+    }
+    size_t equivalenceFailures = 0;
+    for (const EquivalenceCheck &check : outputs.equivalence)
+    {
+        check.printSummary(std::cout);
+        equivalenceFailures += check.failures();
+    }
+    const int timingResult = checkTiming(commandlineArguments, timingRecorder, maxSlowdown, alpha);
+    if (timingResult != 0)
+    {
+        return timingResult;
+    }
+    if (equivalenceFailures != 0)
+    {
+        std::cerr << "Error: " << equivalenceFailures << " frames differ from the reference by more than the tolerance" << std::endl;
+        return 3;
+    }
     return 0;
 }
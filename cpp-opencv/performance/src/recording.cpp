@@ -0,0 +1,417 @@
+#include "recording.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+    const size_t FRAME_HEADER_BYTES = 5;
+    const char INDEX_MAGIC[8] = {'C', 'C', 'R', 'E', 'C', 'I', 'D', 'X'};
+    const uint32_t INDEX_VERSION = 2;
+
+    enum WireType
+    {
+        WIRE_VARINT = 0,
+        WIRE_FIXED64 = 1,
+        WIRE_LENGTH = 2,
+        WIRE_FIXED32 = 5
+    };
+
+    // Reads the proto encoding that cluon's ToProtoVisitor writes, signed integers are zigzag encoded
+    class ProtoCursor
+    {
+    public:
+        ProtoCursor(const uint8_t *data, size_t size) : data_(data), end_(data + size), ok_(true) {}
+
+        bool atEnd() const { return data_ >= end_ || !ok_; }
+        bool ok() const { return ok_; }
+
+        uint64_t varint()
+        {
+            uint64_t value = 0;
+            for (int shift = 0; shift < 64 && data_ < end_; shift += 7)
+            {
+                const uint8_t byte = *data_++;
+                value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+                if ((byte & 0x80) == 0)
+                {
+                    return value;
+                }
+            }
+            ok_ = false;
+            return 0;
+        }
+
+        int64_t zigzag()
+        {
+            const uint64_t value = varint();
+            return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+        }
+
+        // Returns a view of a length delimited field
+        const uint8_t *bytes(size_t &length)
+        {
+            length = static_cast<size_t>(varint());
+            if (!ok_ || length > static_cast<size_t>(end_ - data_))
+            {
+                ok_ = false;
+                return nullptr;
+            }
+            const uint8_t *start = data_;
+            data_ += length;
+            return start;
+        }
+
+        uint32_t fixed32()
+        {
+            uint32_t value = 0;
+            if (end_ - data_ < 4)
+            {
+                ok_ = false;
+                return 0;
+            }
+            std::memcpy(&value, data_, sizeof(value));
+            data_ += sizeof(value);
+            return value;
+        }
+
+        void skip(uint32_t wireType)
+        {
+            size_t length = 0;
+            switch (wireType)
+            {
+            case WIRE_VARINT:
+                varint();
+                break;
+            case WIRE_FIXED64:
+                length = 8;
+                break;
+            case WIRE_LENGTH:
+                bytes(length);
+                length = 0;
+                break;
+            case WIRE_FIXED32:
+                length = 4;
+                break;
+            default:
+                ok_ = false;
+                break;
+            }
+            if (length > static_cast<size_t>(end_ - data_))
+            {
+                ok_ = false;
+                return;
+            }
+            data_ += length;
+        }
+
+    private:
+        const uint8_t *data_;
+        const uint8_t *end_;
+        bool ok_;
+    };
+
+    int64_t parseTimeStampUs(const uint8_t *data, size_t size)
+    {
+        ProtoCursor cursor(data, size);
+        int64_t seconds = 0, microseconds = 0;
+        while (!cursor.atEnd())
+        {
+            const uint64_t key = cursor.varint();
+            if (key == ((1 << 3) | WIRE_VARINT))
+            {
+                seconds = cursor.zigzag();
+            }
+            else if (key == ((2 << 3) | WIRE_VARINT))
+            {
+                microseconds = cursor.zigzag();
+            }
+            else
+            {
+                cursor.skip(static_cast<uint32_t>(key & 7));
+            }
+        }
+        return seconds * 1000000 + microseconds;
+    }
+}
+
+RecordingReader::RecordingReader(const std::string &path)
+    : fd_(-1), data_(nullptr), bytes_(0), index_(), position_(0), types_(), memoryBudget_(0), releasedUpTo_(0)
+{
+    fd_ = ::open(path.c_str(), O_RDONLY);
+    if (fd_ < 0)
+    {
+        return;
+    }
+    struct stat info;
+    if (0 != fstat(fd_, &info) || info.st_size == 0)
+    {
+        return;
+    }
+    const int64_t mtimeNs = static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+    bytes_ = static_cast<size_t>(info.st_size);
+    void *mapped = mmap(nullptr, bytes_, PROT_READ, MAP_PRIVATE, fd_, 0);
+    if (mapped == MAP_FAILED)
+    {
+        return;
+    }
+    madvise(mapped, bytes_, MADV_SEQUENTIAL);
+    data_ = static_cast<const uint8_t *>(mapped);
+    if (!loadIndex(path + ".idx", mtimeNs))
+    {
+        buildIndex();
+        saveIndex(path + ".idx", mtimeNs);
+        // The scan touched every page, the replay should start from an empty page cache footprint
+        madvise(mapped, bytes_, MADV_DONTNEED);
+    }
+}
+
+RecordingReader::~RecordingReader()
+{
+    if (data_ != nullptr)
+    {
+        munmap(const_cast<uint8_t *>(data_), bytes_);
+    }
+    if (fd_ >= 0)
+    {
+        ::close(fd_);
+    }
+}
+
+void RecordingReader::buildIndex()
+{
+    size_t offset = 0;
+    while (offset + FRAME_HEADER_BYTES <= bytes_)
+    {
+        if (data_[offset] != 0x0D || data_[offset + 1] != 0xA4)
+        {
+            break;
+        }
+        const size_t length = data_[offset + 2] | (data_[offset + 3] << 8) | (data_[offset + 4] << 16);
+        const uint8_t *envelope = data_ + offset + FRAME_HEADER_BYTES;
+        if (offset + FRAME_HEADER_BYTES + length > bytes_)
+        {
+            // Truncated last envelope, e.g. from a recording that was not closed properly
+            break;
+        }
+
+        IndexEntry entry{0, 0, 0, 0, offset};
+        ProtoCursor cursor(envelope, length);
+        while (!cursor.atEnd())
+        {
+            const uint64_t key = cursor.varint();
+            const uint32_t field = static_cast<uint32_t>(key >> 3);
+            const uint32_t wireType = static_cast<uint32_t>(key & 7);
+            size_t fieldLength = 0;
+            if (field == 1 && wireType == WIRE_VARINT)
+            {
+                entry.dataType = static_cast<int32_t>(cursor.zigzag());
+            }
+            else if (field == 2 && wireType == WIRE_LENGTH)
+            {
+                const uint8_t *payload = cursor.bytes(fieldLength);
+                entry.payloadOffset = static_cast<uint64_t>(payload - data_);
+                entry.payloadSize = static_cast<uint32_t>(fieldLength);
+            }
+            else if (field == 5 && wireType == WIRE_LENGTH)
+            {
+                const uint8_t *timeStamp = cursor.bytes(fieldLength);
+                entry.sampleTimeUs = parseTimeStampUs(timeStamp, fieldLength);
+            }
+            else
+            {
+                cursor.skip(wireType);
+            }
+        }
+        if (!cursor.ok())
+        {
+            break;
+        }
+        index_.push_back(entry);
+        offset += FRAME_HEADER_BYTES + length;
+    }
+    // cluon::Player replays in sample time order and keeps the file order for equal timestamps
+    std::stable_sort(index_.begin(), index_.end(), [](const IndexEntry &a, const IndexEntry &b)
+                     { return a.sampleTimeUs < b.sampleTimeUs; });
+}
+
+bool RecordingReader::loadIndex(const std::string &path, int64_t mtimeNs)
+{
+    std::ifstream file(path, std::ios::binary);
+    char magic[sizeof(INDEX_MAGIC)];
+    uint32_t version = 0;
+    uint64_t recordingBytes = 0, count = 0;
+    int64_t recordingMtimeNs = 0;
+    if (!file.read(magic, sizeof(magic)) || 0 != std::memcmp(magic, INDEX_MAGIC, sizeof(magic)) ||
+        !file.read(reinterpret_cast<char *>(&version), sizeof(version)) ||
+        !file.read(reinterpret_cast<char *>(&recordingBytes), sizeof(recordingBytes)) ||
+        !file.read(reinterpret_cast<char *>(&recordingMtimeNs), sizeof(recordingMtimeNs)) ||
+        !file.read(reinterpret_cast<char *>(&count), sizeof(count)))
+    {
+        return false;
+    }
+    // A recording that was changed or replaced since the index was written has to be scanned again
+    if (version != INDEX_VERSION || recordingBytes != bytes_ || recordingMtimeNs != mtimeNs)
+    {
+        return false;
+    }
+    // The entries have no padding and are read in one go
+    index_.resize(static_cast<size_t>(count));
+    if (!file.read(reinterpret_cast<char *>(index_.data()), static_cast<std::streamsize>(count * sizeof(IndexEntry))))
+    {
+        index_.clear();
+        return false;
+    }
+    for (const IndexEntry &entry : index_)
+    {
+        if (entry.payloadOffset + entry.payloadSize > bytes_ || entry.envelopeOffset + FRAME_HEADER_BYTES > entry.payloadOffset)
+        {
+            index_.clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+void RecordingReader::saveIndex(const std::string &path, int64_t mtimeNs) const
+{
+    // Written under a temporary name so that an interrupted run never leaves a partial index
+    const std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary);
+        if (!file.is_open())
+        {
+            // The recording may be on a read-only volume, it is then scanned on every open
+            return;
+        }
+        const uint64_t recordingBytes = bytes_, count = index_.size();
+        file.write(INDEX_MAGIC, sizeof(INDEX_MAGIC));
+        file.write(reinterpret_cast<const char *>(&INDEX_VERSION), sizeof(INDEX_VERSION));
+        file.write(reinterpret_cast<const char *>(&recordingBytes), sizeof(recordingBytes));
+        file.write(reinterpret_cast<const char *>(&mtimeNs), sizeof(mtimeNs));
+        file.write(reinterpret_cast<const char *>(&count), sizeof(count));
+        file.write(reinterpret_cast<const char *>(index_.data()), static_cast<std::streamsize>(index_.size() * sizeof(IndexEntry)));
+        if (!file.good())
+        {
+            file.close();
+            std::remove(temporary.c_str());
+            return;
+        }
+    }
+    std::rename(temporary.c_str(), path.c_str());
+}
+
+void RecordingReader::seek(int64_t sampleTimeUs)
+{
+    auto entry = std::lower_bound(index_.begin(), index_.end(), sampleTimeUs, [](const IndexEntry &a, int64_t time)
+                                  { return a.sampleTimeUs < time; });
+    position_ = static_cast<size_t>(entry - index_.begin());
+    releasedUpTo_ = 0;
+}
+
+void RecordingReader::release(uint64_t offset)
+{
+    if (memoryBudget_ == 0 || offset < releasedUpTo_ + memoryBudget_)
+    {
+        return;
+    }
+    // Keep half of the budget behind the current payload, envelopes that are replayed slightly out of
+    // file order are then still mapped. Released pages are read from the file again if touched.
+    static const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t end = static_cast<size_t>(offset - memoryBudget_ / 2) / pageSize * pageSize;
+    if (end > releasedUpTo_)
+    {
+        madvise(const_cast<uint8_t *>(data_) + releasedUpTo_, end - releasedUpTo_, MADV_DONTNEED);
+        releasedUpTo_ = end;
+    }
+}
+
+bool RecordingReader::next(RecordedEnvelope &envelope)
+{
+    while (hasMoreData() && !types_.empty() &&
+           std::find(types_.begin(), types_.end(), index_[position_].dataType) == types_.end())
+    {
+        position_++;
+    }
+    if (!hasMoreData())
+    {
+        return false;
+    }
+    const IndexEntry &entry = index_[position_++];
+    release(entry.payloadOffset);
+    envelope.dataType = entry.dataType;
+    envelope.sampleTimeUs = entry.sampleTimeUs;
+    envelope.payload = data_ + entry.payloadOffset;
+    envelope.payloadSize = entry.payloadSize;
+    envelope.raw = data_ + entry.envelopeOffset;
+    envelope.rawSize = FRAME_HEADER_BYTES + (envelope.raw[2] | (envelope.raw[3] << 8) | (envelope.raw[4] << 16));
+    return true;
+}
+
+bool parseImageReading(const uint8_t *payload, size_t size, ImageView &image)
+{
+    ProtoCursor cursor(payload, size);
+    image.fourcc.clear();
+    image.width = 0;
+    image.height = 0;
+    image.data = nullptr;
+    image.dataSize = 0;
+    while (!cursor.atEnd())
+    {
+        const uint64_t key = cursor.varint();
+        const uint32_t field = static_cast<uint32_t>(key >> 3);
+        const uint32_t wireType = static_cast<uint32_t>(key & 7);
+        size_t length = 0;
+        if (field == 1 && wireType == WIRE_LENGTH)
+        {
+            const uint8_t *fourcc = cursor.bytes(length);
+            if (fourcc != nullptr)
+            {
+                image.fourcc.assign(reinterpret_cast<const char *>(fourcc), length);
+            }
+        }
+        else if (field == 2 && wireType == WIRE_VARINT)
+        {
+            image.width = static_cast<uint32_t>(cursor.varint());
+        }
+        else if (field == 3 && wireType == WIRE_VARINT)
+        {
+            image.height = static_cast<uint32_t>(cursor.varint());
+        }
+        else if (field == 4 && wireType == WIRE_LENGTH)
+        {
+            image.data = cursor.bytes(length);
+            image.dataSize = length;
+        }
+        else
+        {
+            cursor.skip(wireType);
+        }
+    }
+    return cursor.ok();
+}
+
+bool parseGroundSteeringRequest(const uint8_t *payload, size_t size, float &groundSteering)
+{
+    ProtoCursor cursor(payload, size);
+    groundSteering = 0;
+    while (!cursor.atEnd())
+    {
+        const uint64_t key = cursor.varint();
+        if (key == ((1 << 3) | WIRE_FIXED32))
+        {
+            const uint32_t bits = cursor.fixed32();
+            std::memcpy(&groundSteering, &bits, sizeof(groundSteering));
+        }
+        else
+        {
+            cursor.skip(static_cast<uint32_t>(key & 7));
+        }
+    }
+    return cursor.ok();
+}
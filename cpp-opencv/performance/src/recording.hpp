@@ -0,0 +1,105 @@
+#ifndef RECORDING_HPP
+#define RECORDING_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Envelope of a recording. payload points into the memory mapped .rec file and stays valid as
+// long as the RecordingReader exists, nothing is copied.
+struct RecordedEnvelope
+{
+    int32_t dataType;
+    int64_t sampleTimeUs;
+    const uint8_t *payload;
+    size_t payloadSize;
+    // The whole envelope including its 5 byte framing, e.g. to copy it into another recording
+    const uint8_t *raw;
+    size_t rawSize;
+};
+
+// Replays a .rec file in sample time order like cluon::Player, but maps the file into memory
+// and hands out views of the payloads instead of decoding every envelope into a copy.
+//
+// A .rec file is a sequence of 0x0D 0xA4 LEN0 LEN1 LEN2 followed by a proto encoded
+// cluon::data::Envelope of LEN bytes. Only the envelope fields are parsed when the file is
+// opened, the message payloads are left untouched until a caller parses them.
+//
+// The envelope index is kept next to the recording in <recording>.idx and reused as long as
+// the size and modification time of the recording match, so opening a large recording does
+// not need to scan it again:
+//
+//   "CCRECIDX" uint32 version, uint64 recordingBytes, int64 recordingMtimeNs, uint64 count,
+//   count x (uint64 payloadOffset, uint32 payloadSize, int32 dataType, int64 sampleTimeUs, uint64 envelopeOffset)
+class RecordingReader
+{
+public:
+    explicit RecordingReader(const std::string &path);
+    ~RecordingReader();
+    RecordingReader(const RecordingReader &) = delete;
+    RecordingReader &operator=(const RecordingReader &) = delete;
+
+    bool isOpen() const { return data_ != nullptr; }
+    size_t size() const { return index_.size(); }
+    bool hasMoreData() const { return position_ < index_.size(); }
+    // Next envelope in sample time order, returns false at the end of the recording
+    bool next(RecordedEnvelope &envelope);
+    // Start again at the first envelope
+    void rewind()
+    {
+        position_ = 0;
+        releasedUpTo_ = 0;
+    }
+    // Continue at the first envelope with a sample time of at least sampleTimeUs
+    void seek(int64_t sampleTimeUs);
+    // Sample time of the first envelope, 0 for an empty recording
+    int64_t firstSampleTimeUs() const { return index_.empty() ? 0 : index_.front().sampleTimeUs; }
+    // Only return envelopes of these data types, the other payloads are never read. Empty returns all.
+    void setTypeFilter(const std::vector<int32_t> &types) { types_ = types; }
+    // Drop the mapped pages that lie more than bytes behind the replay position, 0 keeps all pages
+    void setMemoryBudget(size_t bytes) { memoryBudget_ = bytes; }
+
+private:
+    struct IndexEntry
+    {
+        uint64_t payloadOffset;
+        uint32_t payloadSize;
+        int32_t dataType;
+        int64_t sampleTimeUs;
+        uint64_t envelopeOffset;
+    };
+    static_assert(sizeof(IndexEntry) == 32, "index entries are stored without padding");
+
+    void buildIndex();
+    bool loadIndex(const std::string &path, int64_t mtimeNs);
+    void saveIndex(const std::string &path, int64_t mtimeNs) const;
+    void release(uint64_t offset);
+
+    int fd_;
+    const uint8_t *data_;
+    size_t bytes_;
+    std::vector<IndexEntry> index_;
+    size_t position_;
+    std::vector<int32_t> types_;
+    size_t memoryBudget_;
+    size_t releasedUpTo_;
+};
+
+// Fields of a proto encoded opendlv.proxy.ImageReading, data points into the parsed payload
+struct ImageView
+{
+    std::string fourcc;
+    uint32_t width;
+    uint32_t height;
+    const uint8_t *data;
+    size_t dataSize;
+};
+
+// Parse an ImageReading (1055) payload, returns false if it is malformed
+bool parseImageReading(const uint8_t *payload, size_t size, ImageView &image);
+
+// Parse a GroundSteeringRequest (1090) payload, returns false if it is malformed
+bool parseGroundSteeringRequest(const uint8_t *payload, size_t size, float &groundSteering);
+
+#endif
@@ -0,0 +1,397 @@
+#include "replay.hpp"
+#include "join.hpp"
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <libyuv.h>
+#include <map>
+#include <wels/codec_api.h>
+
+namespace
+{
+    // Accuracy, CSV output and result row of a processed frame, counted on the first repetition only
+    void recordFrame(int64_t timestamp, float groundTruth, double threshold, std::vector<Variant> &variants, ReplayOutputs &outputs)
+    {
+        // Determine difference between calculated and truth values, unless gsr is 0
+        for (Variant &variant : variants)
+        {
+            if (std::fabs(groundTruth) > 0)
+            {
+                variant.totalValid++;
+                if (std::abs(variant.steering - groundTruth) <= threshold)
+                {
+                    variant.withinRange++;
+                }
+            }
+        }
+        const double calculatedSteering = variants[0].steering;
+        outputs.computedFile << calculatedSteering << "\n";
+        outputs.computedCurrent << timestamp << "," << groundTruth << "," << calculatedSteering << "\n";
+        if (outputs.results)
+        {
+            size_t column = 0;
+            outputs.resultRow[column++] = groundTruth;
+            for (const Variant &variant : variants)
+            {
+                outputs.resultRow[column++] = variant.steering;
+                outputs.resultRow[column++] = variant.frameMs;
+                for (int stage = 0; stage < STAGE_COUNT; stage++)
+                {
+                    outputs.resultRow[column++] = variant.timings.ms[stage];
+                }
+            }
+            outputs.results->append(timestamp, outputs.resultRow.data());
+        }
+    }
+
+    // OpenH264 decoder that converts every picture to a BGR cv::Mat
+    class H264Decoder
+    {
+    public:
+        H264Decoder() : decoder_(nullptr)
+        {
+        }
+        ~H264Decoder()
+        {
+            if (decoder_)
+            {
+                decoder_->Uninitialize();
+                WelsDestroyDecoder(decoder_);
+            }
+        }
+        H264Decoder(const H264Decoder &) = delete;
+        H264Decoder &operator=(const H264Decoder &) = delete;
+
+        bool open()
+        {
+            WelsCreateDecoder(&decoder_);
+            if (!decoder_)
+            {
+                std::cerr << "Failed to create decoder" << std::endl;
+                return false;
+            }
+
+            SDecodingParam decoding_param;
+            memset(&decoding_param, 0, sizeof(SDecodingParam));
+            decoding_param.eEcActiveIdc = ERROR_CON_DISABLE;
+            decoding_param.bParseOnly = false;
+            decoding_param.sVideoProperty.eVideoBsType = VIDEO_BITSTREAM_DEFAULT;
+
+            if (cmResultSuccess != decoder_->Initialize(&decoding_param))
+            {
+                std::cerr << "Failed to initialize decoder" << std::endl;
+                return false;
+            }
+            return true;
+        }
+
+        // Returns false if the frame cannot be decoded. bgrImage stays empty while the decoder has no
+        // picture to show yet.
+        bool decode(const ImageView &img, cv::Mat &bgrImage)
+        {
+            // Note: The following segment is code taken, but appropriated, from here ->
+            // https://github.com/chalmers-revere/opendlv-video-h264-decoder/blob/master/src/opendlv-video-h264-decoder.cpp
+            const uint32_t WIDTH = img.width;
+            const uint32_t HEIGHT = img.height;
+            // Prepare the buffer for decoding.
+            uint8_t *yuvData[3]; // Pointers to Y, U, and V planes.
+            SBufferInfo bufferInfo;
+            memset(&bufferInfo, 0, sizeof(SBufferInfo));
+            // Decode the H264 frame straight from the recording, without copying it
+            const int LEN = static_cast<int>(img.dataSize);
+            bgrImage.release();
+            if (0 != decoder_->DecodeFrame2(img.data, LEN, yuvData, &bufferInfo))
+            {
+                return false;
+            }
+            // If the decoding is successful and the buffer is valid.
+            if (1 == bufferInfo.iBufferStatus)
+            {
+                // Convert the YUV data to a cv::Mat in BGR format.
+                bgrImage.create(HEIGHT, WIDTH, CV_8UC3);
+                libyuv::I420ToRGB24(
+                    yuvData[0], bufferInfo.UsrData.sSystemBuffer.iStride[0], // Y plane.
+                    yuvData[1], bufferInfo.UsrData.sSystemBuffer.iStride[1], // U plane.
+                    yuvData[2], bufferInfo.UsrData.sSystemBuffer.iStride[1], // V plane.
+                    bgrImage.data, WIDTH * 3,                                // Destination (BGR format).
+                    WIDTH, HEIGHT                                            // Dimensions.
+                );
+            }
+            return true;
+        }
+
+    private:
+        ISVCDecoder *decoder_;
+    };
+
+    // One replay of the recording. Decoded frames wait until the joiner knows their ground truth and are
+    // then processed by every variant, frames without ground truth within the tolerance are dropped.
+    class Repetition
+    {
+    public:
+        Repetition(bool first, const ReplaySettings &settings, std::vector<Variant> &variants, ReplayOutputs &outputs,
+                   TimingRecorder &timingRecorder)
+            : first_(first), settings_(settings), variants_(variants), outputs_(outputs), timingRecorder_(timingRecorder),
+              joiner_(static_cast<int64_t>(settings.matchToleranceMs * 1000)), pendingFrames_(), nextFrameId_(0)
+        {
+        }
+        Repetition(const Repetition &) = delete;
+        Repetition &operator=(const Repetition &) = delete;
+
+        // Returns the id of the frame, ids count up from 0 in decoding order
+        uint64_t addFrame(int64_t timeUs, const cv::Mat &frame)
+        {
+            pendingFrames_[nextFrameId_] = frame;
+            joiner_.addFrame(nextFrameId_, timeUs);
+            return nextFrameId_++;
+        }
+        void addGroundTruth(int64_t timeUs, float groundTruth)
+        {
+            joiner_.addGroundTruth(timeUs, groundTruth);
+        }
+        // The recording is replayed in sample time order, nothing earlier than timeUs follows
+        void advanceTo(int64_t timeUs)
+        {
+            joiner_.advanceTo(timeUs);
+        }
+        void finish()
+        {
+            joiner_.finish();
+            evaluateMatchedFrames();
+        }
+        const FrameJoiner &joiner() const { return joiner_; }
+
+        // Process the frames whose ground truth is known
+        void evaluateMatchedFrames()
+        {
+            FrameMatch match{0, 0, false, 0, 0};
+            while (joiner_.next(match))
+            {
+                auto frame = pendingFrames_.find(match.frameId);
+                if (first_ && !outputs_.decimation.empty())
+                {
+                    runDecimation(frame->second, match.frameId, match.frameTimeUs, match.matched, match.groundTruth,
+                                  settings_.threshold, outputs_.decimation);
+                }
+                if (match.matched)
+                {
+                    evaluateFrame(match, frame->second);
+                }
+                else if (outputs_.pacer)
+                {
+                    // The car processes every frame, with or without ground truth. The frame is only timed,
+                    // on a copy of the state, so every variant keeps the state of an unpaced replay.
+                    SteeringState pacedState = variants_[0].state;
+                    auto start = std::chrono::steady_clock::now();
+                    variants_[0].engine(frame->second, false, variants_[0].config, pacedState, nullptr);
+                    outputs_.pacer->addBusy(match.frameId, match.frameTimeUs, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+                }
+                pendingFrames_.erase(frame);
+            }
+        }
+
+    private:
+        // Process frame with every variant to calculate steering and time every stage of it
+        void evaluateFrame(const FrameMatch &match, const cv::Mat &frame)
+        {
+            TRACE_SCOPE("evaluateFrame");
+            runVariants(frame, variants_, settings_.verbose);
+            timingRecorder_.addFrame(variants_[0].timings, variants_[0].frameMs);
+            if (outputs_.profile)
+            {
+                outputs_.counterSummary.addFrame(outputs_.frameCounters);
+                if (outputs_.countersFile.is_open() && first_)
+                {
+                    writeCounterRow(outputs_.countersFile, match.frameTimeUs, outputs_.frameCounters);
+                }
+            }
+            if (outputs_.pacer)
+            {
+                outputs_.pacer->addBusy(match.frameId, match.frameTimeUs, variants_[0].frameMs);
+            }
+            if (!first_)
+            {
+                return;
+            }
+            for (size_t v = 0; v < outputs_.equivalence.size(); v++)
+            {
+                writeEquivalenceRow(outputs_.equivalenceFile, match.frameTimeUs, variants_[v].label, outputs_.equivalence[v].check(frame));
+            }
+            recordFrame(match.frameTimeUs, match.groundTruth, settings_.threshold, variants_, outputs_);
+            if (outputs_.injectLatency)
+            {
+                outputs_.latencyOutputs.push_back(SteeringOutput{match.frameTimeUs, variants_[0].steering, variants_[0].frameMs});
+            }
+            if (outputs_.detections)
+            {
+                outputs_.detections->append(frame.size(), DetectionRecord{match.frameTimeUs, match.groundTruth,
+                                                                          variants_[0].state.blueCentroids,
+                                                                          variants_[0].state.yellowCentroids});
+            }
+        }
+
+        bool first_;
+        const ReplaySettings &settings_;
+        std::vector<Variant> &variants_;
+        ReplayOutputs &outputs_;
+        TimingRecorder &timingRecorder_;
+        FrameJoiner joiner_;                          // pairs frames with the nearest ground truth
+        std::map<uint64_t, cv::Mat> pendingFrames_;   // decoded frames waiting for their ground truth
+        uint64_t nextFrameId_;
+    };
+}
+
+ReplayOutputs::ReplayOutputs()
+    : computedFile(), computedCurrent(), results(), resultRow(), detections(), decimation(), injectLatency(false),
+      latencyOutputs(), latencyTruth(), pacer(), worstOverruns(5), profile(false), frameCounters(), counterSummary(),
+      countersFile(), equivalence(), equivalenceFile()
+{
+}
+
+std::vector<std::string> resultColumns(const std::vector<Variant> &variants)
+{
+    std::vector<std::string> columns = {"groundTruth"};
+    for (size_t v = 0; v < variants.size(); v++)
+    {
+        columns.push_back(variantColumn(variants, v, "steering"));
+        columns.push_back(variantColumn(variants, v, "frame_ms"));
+        for (int stage = 0; stage < STAGE_COUNT; stage++)
+        {
+            columns.push_back(variantColumn(variants, v, std::string(STAGE_NAMES[stage]) + "_ms"));
+        }
+    }
+    return columns;
+}
+
+void replayDetections(const DetectionReader &cachedDetections, const ReplaySettings &settings, std::vector<Variant> &variants,
+                      ReplayOutputs &outputs, TimingRecorder &timingRecorder)
+{
+    for (int repetition = 0; repetition < settings.repetitions; repetition++)
+    {
+        resetVariants(variants);
+        timingRecorder.beginRepetition();
+        auto repetitionStart = std::chrono::steady_clock::now();
+        DetectionRecord record{0, 0, {}, {}};
+        for (size_t i = 0; i < cachedDetections.size(); i++)
+        {
+            if (!cachedDetections.read(i, record))
+            {
+                continue;
+            }
+            steerVariants(cachedDetections.frameSize(), record.blue, record.yellow, variants);
+            timingRecorder.addFrame(variants[0].timings, variants[0].frameMs);
+            if (repetition == 0)
+            {
+                recordFrame(record.timestamp, record.groundTruth, settings.threshold, variants, outputs);
+            }
+        }
+        timingRecorder.endRepetition(std::chrono::duration<double>(std::chrono::steady_clock::now() - repetitionStart).count());
+    }
+}
+
+bool replayRecording(RecordingReader &recording, const ReplaySettings &settings, std::vector<Variant> &variants,
+                     ReplayOutputs &outputs, TimingRecorder &timingRecorder)
+{
+    TRACE_THREAD_NAME("replay");
+    for (int repetitionIndex = 0; repetitionIndex < settings.repetitions; repetitionIndex++)
+    {
+        const bool firstRepetition = (repetitionIndex == 0);
+        resetVariants(variants);
+        Repetition repetition(firstRepetition, settings, variants, outputs, timingRecorder);
+        int failures = 0;                                 // counts frames that failed to decode / process
+
+        H264Decoder decoder;
+        if (!decoder.open())
+        {
+            return false;
+        }
+
+        timingRecorder.beginRepetition();
+        auto repetitionStart = std::chrono::steady_clock::now();
+
+        // loop that ends when .rec file has no more data
+        RecordedEnvelope envelope{0, 0, nullptr, 0, nullptr, 0};
+        ImageView img{"", 0, 0, nullptr, 0};              // variable to store the imagereading fields
+        float groundSteering = 0;                         // variable to store the gsr value
+        cv::Mat bgrImage;
+        recording.rewind();
+        if (settings.startSeconds > 0)
+        {
+            recording.seek(recording.firstSampleTimeUs() + static_cast<int64_t>(settings.startSeconds * 1e6));
+        }
+        bool paceStarted = false;
+        while (recording.next(envelope))
+        {
+            if (outputs.pacer)
+            {
+                if (!paceStarted)
+                {
+                    outputs.pacer->start(envelope.sampleTimeUs);
+                    paceStarted = true;
+                }
+                TRACE_SCOPE("paceWait");
+                outputs.pacer->waitUntil(envelope.sampleTimeUs);
+            }
+            repetition.advanceTo(envelope.sampleTimeUs);
+            // if datatype is ImageReading (see opendlv-standard-message-set)
+            if (envelope.dataType == 1055)
+            {
+                // The image fields and the H264 data are views into the memory mapped recording
+                if (!parseImageReading(envelope.payload, envelope.payloadSize, img))
+                {
+                    failures++;
+                    continue;
+                }
+                // Check if the image encoding is H264. Every frame is decoded, later frames reference it
+                // even if it has no ground truth itself.
+                if ("h264" == img.fourcc)
+                {
+                    TRACE_SCOPE("decode");
+                    auto decodeStart = std::chrono::steady_clock::now();
+                    if (!decoder.decode(img, bgrImage))
+                    {
+                        failures++;
+                    }
+                    else if (!bgrImage.empty())
+                    {
+                        const double decodeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - decodeStart).count();
+                        // Keep the frame until the joiner knows its ground truth
+                        const uint64_t frameId = repetition.addFrame(envelope.sampleTimeUs, bgrImage);
+                        if (outputs.pacer)
+                        {
+                            outputs.pacer->addBusy(frameId, envelope.sampleTimeUs, decodeMs);
+                        }
+                    }
+                }
+            }
+            // if datatype is GroundSteeringRequest (see: opendlv-standard-message-set)
+            else if (envelope.dataType == 1090)
+            {
+                if (parseGroundSteeringRequest(envelope.payload, envelope.payloadSize, groundSteering))
+                {
+                    repetition.addGroundTruth(envelope.sampleTimeUs, groundSteering);
+                    if (firstRepetition && outputs.injectLatency)
+                    {
+                        outputs.latencyTruth.push_back(GroundTruthSample{envelope.sampleTimeUs, groundSteering});
+                    }
+                }
+            }
+            repetition.evaluateMatchedFrames();
+        }
+        repetition.finish();
+        if (outputs.pacer)
+        {
+            outputs.pacer->report(std::cout, outputs.worstOverruns);
+        }
+        if (firstRepetition)
+        {
+            const FrameJoiner &joiner = repetition.joiner();
+            std::cout << "Frames: " << joiner.frames() << " decoded, " << joiner.matched() << " with ground truth, "
+                      << joiner.dropped() << " without ground truth within " << settings.matchToleranceMs << " ms, "
+                      << failures << " failed to decode" << std::endl;
+        }
+        timingRecorder.endRepetition(std::chrono::duration<double>(std::chrono::steady_clock::now() - repetitionStart).count());
+    }
+    return true;
+}
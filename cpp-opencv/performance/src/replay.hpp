@@ -0,0 +1,72 @@
+#ifndef REPLAY_HPP
+#define REPLAY_HPP
+
+#include "decimation.hpp"
+#include "detectioncache.hpp"
+#include "equivalence.hpp"
+#include "latency.hpp"
+#include "pacing.hpp"
+#include "perfcounters.hpp"
+#include "recording.hpp"
+#include "results.hpp"
+#include "timing.hpp"
+#include "variants.hpp"
+#include <cstddef>
+#include <fstream>
+#include <memory>
+#include <vector>
+
+// How the recording is replayed
+struct ReplaySettings
+{
+    int repetitions;
+    double startSeconds;      // Skip this much of the recording, uses the <recording>.idx index
+    double matchToleranceMs;  // Frames are paired with the nearest ground truth within this, others are dropped
+    double threshold;         // Largest steering difference that counts as accurate
+    bool verbose;
+};
+
+// Everything a replay writes or measures besides the variants and the timing summary. Only the two
+// CSV files are always open, the rest stays empty (or nullptr) unless it was asked for.
+struct ReplayOutputs
+{
+    ReplayOutputs();
+
+    std::ofstream computedFile;     // Steering of the first variant, one row per frame
+    std::ofstream computedCurrent;  // Timestamp, ground truth and steering of the first variant
+    std::unique_ptr<ResultWriter> results; // One row per frame and columns for every variant
+    std::vector<double> resultRow;
+    std::unique_ptr<DetectionWriter> detections; // Cone detections of the first variant for --steering-only
+
+    // Studies of the first variant
+    std::vector<DecimationRate> decimation;
+    bool injectLatency;  // Keep the outputs and ground truth of the first repetition to delay them afterwards
+    std::vector<SteeringOutput> latencyOutputs;
+    std::vector<GroundTruthSample> latencyTruth;
+    std::unique_ptr<PacedReplay> pacer;
+    size_t worstOverruns;
+    bool profile;        // variants[0].counters points to frameCounters
+    StageCounters frameCounters;
+    CounterSummary counterSummary;
+    std::ofstream countersFile;
+
+    // One check of every variant against the frozen reference pipeline
+    std::vector<EquivalenceCheck> equivalence;
+    std::ofstream equivalenceFile;
+};
+
+// Result columns of the variants, open outputs.results with them
+std::vector<std::string> resultColumns(const std::vector<Variant> &variants);
+
+// Re-run only the steering math of every variant on the cached detections instead of decoding
+// the recording. Only the first repetition writes the outputs and counts accuracy.
+void replayDetections(const DetectionReader &cachedDetections, const ReplaySettings &settings, std::vector<Variant> &variants,
+                      ReplayOutputs &outputs, TimingRecorder &timingRecorder);
+
+// Decode the recording and run every variant on the frames that have ground truth. Every repetition
+// replays the whole recording, only the first one writes the outputs and counts accuracy. Returns
+// false if the decoder cannot be set up.
+bool replayRecording(RecordingReader &recording, const ReplaySettings &settings, std::vector<Variant> &variants,
+                     ReplayOutputs &outputs, TimingRecorder &timingRecorder);
+
+#endif
@@ -0,0 +1,409 @@
+#include "results.hpp"
+#include "downsample.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+
+namespace
+{
+    const char MAGIC[8] = {'C', 'C', 'R', 'E', 'S', 'U', 'L', 'T'};
+    const uint32_t VERSION = 1;
+    const size_t BLOCK_ROWS = 4096;
+
+    template <typename T>
+    void writeValue(std::ofstream &file, const T &value)
+    {
+        file.write(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    bool readValue(std::ifstream &file, T &value)
+    {
+        return static_cast<bool>(file.read(reinterpret_cast<char *>(&value), sizeof(T)));
+    }
+
+    // Running totals of one side of a comparison
+    struct RunStats
+    {
+        int validRows;
+        int withinRange;
+    };
+
+    // A timing column (name ending in _ms) present in both files
+    struct LatencyColumn
+    {
+        std::string name;
+        int index[2];
+        double sum[2];
+    };
+
+    bool isLatencyColumn(const std::string &name)
+    {
+        return name.size() > 3 && 0 == name.compare(name.size() - 3, 3, "_ms");
+    }
+
+    // The rows a StreamingLttb selected, the x values are the timestamps
+    bool writeDownsampled(const std::string &path, const std::string &header, const StreamingLttb &plot)
+    {
+        std::ofstream file(path);
+        if (!file.is_open())
+        {
+            return false;
+        }
+        file << header << "\n";
+        for (size_t row = 0; row < plot.x().size(); row++)
+        {
+            file << static_cast<int64_t>(plot.x()[row]);
+            for (double value : plot.series()[row])
+            {
+                file << "," << value;
+            }
+            file << "\n";
+        }
+        return file.good();
+    }
+
+    double percentage(int part, int total)
+    {
+        return total > 0 ? 100.0 * part / total : 0.0;
+    }
+}
+
+ResultWriter::ResultWriter(const std::string &path, const std::vector<std::string> &columns)
+    : file_(path, std::ios::binary), columnCount_(columns.size()), timestamps_(), values_(columns.size())
+{
+    if (!file_.is_open())
+    {
+        return;
+    }
+    file_.write(MAGIC, sizeof(MAGIC));
+    writeValue(file_, VERSION);
+    writeValue(file_, static_cast<uint32_t>(columns.size()));
+    for (const std::string &name : columns)
+    {
+        writeValue(file_, static_cast<uint16_t>(name.size()));
+        file_.write(name.data(), static_cast<std::streamsize>(name.size()));
+    }
+    timestamps_.reserve(BLOCK_ROWS);
+    for (std::vector<double> &column : values_)
+    {
+        column.reserve(BLOCK_ROWS);
+    }
+}
+
+ResultWriter::~ResultWriter()
+{
+    close();
+}
+
+void ResultWriter::append(int64_t timestamp, const double *values)
+{
+    timestamps_.push_back(timestamp);
+    for (size_t i = 0; i < columnCount_; i++)
+    {
+        values_[i].push_back(values[i]);
+    }
+    if (timestamps_.size() == BLOCK_ROWS)
+    {
+        flush();
+    }
+}
+
+void ResultWriter::close()
+{
+    if (file_.is_open())
+    {
+        flush();
+        file_.close();
+    }
+}
+
+void ResultWriter::flush()
+{
+    if (timestamps_.empty() || !file_.is_open())
+    {
+        return;
+    }
+    writeValue(file_, static_cast<uint32_t>(timestamps_.size()));
+    file_.write(reinterpret_cast<const char *>(timestamps_.data()), static_cast<std::streamsize>(timestamps_.size() * sizeof(int64_t)));
+    for (std::vector<double> &column : values_)
+    {
+        file_.write(reinterpret_cast<const char *>(column.data()), static_cast<std::streamsize>(column.size() * sizeof(double)));
+        column.clear();
+    }
+    timestamps_.clear();
+}
+
+ResultReader::ResultReader(const std::string &path)
+    : file_(path, std::ios::binary), valid_(false), columns_(), timestamps_(), values_(), row_(0)
+{
+    char magic[sizeof(MAGIC)];
+    uint32_t version = 0;
+    uint32_t columnCount = 0;
+    if (!file_.read(magic, sizeof(magic)) || 0 != std::memcmp(magic, MAGIC, sizeof(MAGIC)) ||
+        !readValue(file_, version) || version != VERSION || !readValue(file_, columnCount))
+    {
+        return;
+    }
+    for (uint32_t i = 0; i < columnCount; i++)
+    {
+        uint16_t length = 0;
+        if (!readValue(file_, length))
+        {
+            return;
+        }
+        std::string name(length, '\0');
+        if (!file_.read(&name[0], length))
+        {
+            return;
+        }
+        columns_.push_back(name);
+    }
+    values_.resize(columns_.size());
+    valid_ = true;
+}
+
+int ResultReader::columnIndex(const std::string &name) const
+{
+    for (size_t i = 0; i < columns_.size(); i++)
+    {
+        if (columns_[i] == name)
+        {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+bool ResultReader::readBlock()
+{
+    uint32_t rows = 0;
+    if (!valid_ || !readValue(file_, rows) || rows == 0)
+    {
+        return false;
+    }
+    timestamps_.resize(rows);
+    if (!file_.read(reinterpret_cast<char *>(timestamps_.data()), static_cast<std::streamsize>(rows * sizeof(int64_t))))
+    {
+        return false;
+    }
+    for (std::vector<double> &column : values_)
+    {
+        column.resize(rows);
+        if (!file_.read(reinterpret_cast<char *>(column.data()), static_cast<std::streamsize>(rows * sizeof(double))))
+        {
+            return false;
+        }
+    }
+    row_ = 0;
+    return true;
+}
+
+bool ResultReader::next(int64_t &timestamp, std::vector<double> &values)
+{
+    if (row_ >= timestamps_.size() && !readBlock())
+    {
+        return false;
+    }
+    timestamp = timestamps_[row_];
+    values.resize(values_.size());
+    for (size_t i = 0; i < values_.size(); i++)
+    {
+        values[i] = values_[i][row_];
+    }
+    row_++;
+    return true;
+}
+
+bool joinResults(const std::string &currentPath, const std::string &previousPath, int64_t toleranceUs,
+                 const std::function<void(int64_t, const std::vector<double> &, const std::vector<double> &)> &onMatch, JoinCounts &counts)
+{
+    ResultReader current(currentPath);
+    ResultReader previous(previousPath);
+    counts = JoinCounts{0, 0, 0};
+    if (!current.isOpen() || !previous.isOpen())
+    {
+        return false;
+    }
+    int64_t ts[2] = {0, 0};
+    std::vector<double> row[2];
+    bool has[2] = {current.next(ts[0], row[0]), previous.next(ts[1], row[1])};
+    while (has[0] && has[1])
+    {
+        if (ts[0] + toleranceUs < ts[1])
+        {
+            counts.onlyCurrent++;
+            has[0] = current.next(ts[0], row[0]);
+            continue;
+        }
+        if (ts[1] + toleranceUs < ts[0])
+        {
+            counts.onlyPrevious++;
+            has[1] = previous.next(ts[1], row[1]);
+            continue;
+        }
+        counts.matched++;
+        onMatch(ts[0], row[0], row[1]);
+        has[0] = current.next(ts[0], row[0]);
+        has[1] = previous.next(ts[1], row[1]);
+    }
+    while (has[0])
+    {
+        counts.onlyCurrent++;
+        has[0] = current.next(ts[0], row[0]);
+    }
+    while (has[1])
+    {
+        counts.onlyPrevious++;
+        has[1] = previous.next(ts[1], row[1]);
+    }
+    return true;
+}
+
+bool compareResults(std::ostream &out, const std::string &currentPath, const std::string &previousPath,
+                    int64_t toleranceUs, double threshold, const std::string &joinedCsv, size_t plotPoints)
+{
+    ResultReader current(currentPath);
+    ResultReader previous(previousPath);
+    if (!current.isOpen() || !previous.isOpen())
+    {
+        out << "Error: Could not read result files " << currentPath << " and " << previousPath << std::endl;
+        return false;
+    }
+    const int truthColumn[2] = {current.columnIndex("groundTruth"), previous.columnIndex("groundTruth")};
+    const int steeringColumn[2] = {current.columnIndex("steering"), previous.columnIndex("steering")};
+    if (truthColumn[0] < 0 || truthColumn[1] < 0 || steeringColumn[0] < 0 || steeringColumn[1] < 0)
+    {
+        out << "Error: Result files need groundTruth and steering columns" << std::endl;
+        return false;
+    }
+
+    std::vector<LatencyColumn> latencies;
+    for (const std::string &name : current.columns())
+    {
+        if (isLatencyColumn(name) && previous.columnIndex(name) >= 0)
+        {
+            latencies.push_back(LatencyColumn{name, {current.columnIndex(name), previous.columnIndex(name)}, {0, 0}});
+        }
+    }
+
+    // Merge join of both streams on the timestamp
+    RunStats stats[2] = {{0, 0}, {0, 0}};
+    int sameDecision = 0;
+    double absDeltaSum = 0, maxAbsDelta = 0;
+    JoinCounts counts{0, 0, 0};
+    joinResults(currentPath, previousPath, toleranceUs, [&](int64_t, const std::vector<double> &currentRow, const std::vector<double> &previousRow)
+                {
+                    const std::vector<double> *row[2] = {&currentRow, &previousRow};
+                    bool within[2] = {false, false};
+                    for (int side = 0; side < 2; side++)
+                    {
+                        double truth = (*row[side])[truthColumn[side]];
+                        within[side] = std::abs((*row[side])[steeringColumn[side]] - truth) <= threshold;
+                        if (std::abs(truth) > 0)
+                        {
+                            stats[side].validRows++;
+                            stats[side].withinRange += within[side] ? 1 : 0;
+                        }
+                        for (LatencyColumn &latency : latencies)
+                        {
+                            latency.sum[side] += (*row[side])[latency.index[side]];
+                        }
+                    }
+                    sameDecision += (within[0] == within[1]) ? 1 : 0;
+                    double delta = std::abs(currentRow[steeringColumn[0]] - previousRow[steeringColumn[1]]);
+                    absDeltaSum += delta;
+                    maxAbsDelta = std::max(maxAbsDelta, delta);
+                }, counts);
+    const int matched = counts.matched;
+
+    double accuracy[2] = {percentage(stats[0].withinRange, stats[0].validRows),
+                          percentage(stats[1].withinRange, stats[1].validRows)};
+    const std::ios::fmtflags flags = out.flags();
+    const std::streamsize precision = out.precision();
+    out << std::fixed << std::setprecision(3);
+    out << "Matched rows:        " << matched << " (only current " << counts.onlyCurrent << ", only previous " << counts.onlyPrevious << ")" << std::endl;
+    out << "Accuracy:            " << accuracy[1] << "% -> " << accuracy[0] << "% (" << std::showpos << accuracy[0] - accuracy[1] << std::noshowpos << " points)" << std::endl;
+    out << "Same decision:       " << percentage(sameDecision, matched) << "%" << std::endl;
+    out << "Steering delta:      mean " << (matched > 0 ? absDeltaSum / matched : 0.0) << ", max " << maxAbsDelta << std::endl;
+    for (const LatencyColumn &latency : latencies)
+    {
+        double before = matched > 0 ? latency.sum[1] / matched : 0.0;
+        double after = matched > 0 ? latency.sum[0] / matched : 0.0;
+        out << std::left << std::setw(21) << (latency.name + ":") << std::right << before << " -> " << after << " ("
+            << std::showpos << (before > 0 ? (after / before - 1) * 100.0 : 0.0) << std::noshowpos << "%)" << std::endl;
+    }
+    out.flags(flags);
+    out.precision(precision);
+
+    if (joinedCsv.empty())
+    {
+        return true;
+    }
+    // The joined series is downsampled in two more passes over both files instead of being held in memory
+    StreamingLttb joined(static_cast<size_t>(matched), plotPoints);
+    std::vector<double> series(3);
+    for (int pass = 0; pass < 2; pass++)
+    {
+        joinResults(currentPath, previousPath, toleranceUs, [&](int64_t timestamp, const std::vector<double> &currentRow, const std::vector<double> &previousRow)
+                    {
+                        series[0] = currentRow[truthColumn[0]];
+                        series[1] = currentRow[steeringColumn[0]];
+                        series[2] = previousRow[steeringColumn[1]];
+                        if (pass == 0)
+                        {
+                            joined.average(static_cast<double>(timestamp), series);
+                        }
+                        else
+                        {
+                            joined.select(static_cast<double>(timestamp), series);
+                        }
+                    }, counts);
+    }
+    if (!writeDownsampled(joinedCsv, "timestamp,groundTruth,groundSteering,prevGroundSteering", joined))
+    {
+        out << "Error: Could not write " << joinedCsv << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool writePlotSeries(const std::string &resultsPath, const std::string &csvPath, size_t plotPoints)
+{
+    ResultReader results(resultsPath);
+    const int truthColumn = results.columnIndex("groundTruth");
+    const int steeringColumn = results.columnIndex("steering");
+    if (!results.isOpen() || truthColumn < 0 || steeringColumn < 0)
+    {
+        return false;
+    }
+    // One pass to count the rows and two to downsample them, so the series is never held in memory
+    size_t rows = 0;
+    int64_t timestamp = 0;
+    std::vector<double> row;
+    while (results.next(timestamp, row))
+    {
+        rows++;
+    }
+    StreamingLttb plot(rows, plotPoints);
+    std::vector<double> series(2);
+    for (int pass = 0; pass < 2; pass++)
+    {
+        ResultReader reader(resultsPath);
+        while (reader.next(timestamp, row))
+        {
+            series[0] = row[truthColumn];
+            series[1] = row[steeringColumn];
+            if (pass == 0)
+            {
+                plot.average(static_cast<double>(timestamp), series);
+            }
+            else
+            {
+                plot.select(static_cast<double>(timestamp), series);
+            }
+        }
+    }
+    return writeDownsampled(csvPath, "timestamp,groundTruth,groundSteering", plot);
+}
@@ -0,0 +1,88 @@
+#ifndef RESULTS_HPP
+#define RESULTS_HPP
+
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Binary columnar result file, written in blocks so that hours of recordings can be streamed.
+// All numbers are stored in host byte order (little-endian on every platform we build for).
+//
+//   header: "CCRESULT" uint32 version, uint32 columnCount, columnCount x (uint16 length, name)
+//   block:  uint32 rows, int64 timestamp[rows], columnCount x double value[rows]
+//
+// The timestamp (sample time in microseconds) is implicit and not part of the column names.
+class ResultWriter
+{
+public:
+    ResultWriter(const std::string &path, const std::vector<std::string> &columns);
+    ~ResultWriter();
+    ResultWriter(const ResultWriter &) = delete;
+    ResultWriter &operator=(const ResultWriter &) = delete;
+
+    bool isOpen() const { return file_.is_open(); }
+    // values must hold one entry per column
+    void append(int64_t timestamp, const double *values);
+    void close();
+
+private:
+    void flush();
+
+    std::ofstream file_;
+    size_t columnCount_;
+    std::vector<int64_t> timestamps_;
+    std::vector<std::vector<double>> values_;
+};
+
+class ResultReader
+{
+public:
+    explicit ResultReader(const std::string &path);
+
+    bool isOpen() const { return valid_; }
+    const std::vector<std::string> &columns() const { return columns_; }
+    // Index of the named column or -1 if the file does not have it
+    int columnIndex(const std::string &name) const;
+    // Read the next row, returns false at the end of the file
+    bool next(int64_t &timestamp, std::vector<double> &values);
+
+private:
+    bool readBlock();
+
+    std::ifstream file_;
+    bool valid_;
+    std::vector<std::string> columns_;
+    std::vector<int64_t> timestamps_;
+    std::vector<std::vector<double>> values_;
+    size_t row_;
+};
+
+// Rows of a merge join of two result files
+struct JoinCounts
+{
+    int matched;
+    int onlyCurrent;
+    int onlyPrevious;
+};
+
+// Merge join of two result files on their timestamps, both files are expected in replay order.
+// Rows are matched when their timestamps differ by at most toleranceUs, onMatch gets the timestamp
+// of the current row and both rows. Streams both files, returns false if one cannot be read.
+bool joinResults(const std::string &currentPath, const std::string &previousPath, int64_t toleranceUs,
+                 const std::function<void(int64_t, const std::vector<double> &, const std::vector<double> &)> &onMatch, JoinCounts &counts);
+
+// Join two result files with joinResults and report accuracy and latency differences. The joined
+// rows are optionally written to joinedCsv as timestamp,groundTruth,groundSteering,prevGroundSteering
+// for plotting, downsampled to plotPoints rows (0 keeps all rows) in two more passes over the files,
+// so the memory does not grow with the length of the recording.
+bool compareResults(std::ostream &out, const std::string &currentPath, const std::string &previousPath,
+                    int64_t toleranceUs, double threshold, const std::string &joinedCsv, size_t plotPoints);
+
+// Write timestamp,groundTruth,groundSteering of a result file as CSV, downsampled to plotPoints rows
+// in passes over the file like compareResults
+bool writePlotSeries(const std::string &resultsPath, const std::string &csvPath, size_t plotPoints);
+
+#endif
@@ -0,0 +1,201 @@
+#include "cluon-complete.hpp"
+#include "opendlv-standard-message-set.hpp"
+#include "steering.hpp"
+#include "synthetic.hpp"
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include <libyuv.h>
+#include <wels/codec_api.h>
+
+namespace
+{
+    // First sample time of every synthetic recording, fixed so that the output is reproducible
+    const int64_t START_US = 1600000000LL * 1000000;
+
+    double option(std::map<std::string, std::string> &arguments, const std::string &key, double fallback)
+    {
+        return (arguments.count(key) != 0) ? std::stod(arguments[key]) : fallback;
+    }
+
+    cluon::data::TimeStamp timeStamp(int64_t us)
+    {
+        cluon::data::TimeStamp stamp;
+        stamp.seconds(static_cast<int32_t>(us / 1000000)).microseconds(static_cast<int32_t>(us % 1000000));
+        return stamp;
+    }
+
+    // Wrap a message into an envelope stamped with the given sample time and write it like cluon-rec does
+    template <typename T>
+    void writeEnvelope(std::ofstream &out, T &message, int64_t sampleTimeUs)
+    {
+        cluon::ToProtoVisitor protoEncoder;
+        message.accept(protoEncoder);
+        cluon::data::Envelope envelope;
+        envelope.dataType(static_cast<int32_t>(T::ID()))
+            .serializedData(protoEncoder.encodedData())
+            .sent(timeStamp(sampleTimeUs))
+            .received(timeStamp(sampleTimeUs))
+            .sampleTimeStamp(timeStamp(sampleTimeUs));
+        const std::string bytes = cluon::serializeEnvelope(std::move(envelope));
+        out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    }
+}
+
+int32_t main(int32_t argc, char **argv)
+{
+    auto commandlineArguments = cluon::getCommandlineArguments(argc, argv);
+    if (commandlineArguments.count("out") == 0)
+    {
+        std::cerr << argv[0] << " renders synthetic cone scenes and writes them as an H264 recording with ground truth." << std::endl;
+        std::cerr << "Usage:   " << argv[0] << " --out=<Synthetic.rec> [--width=<w>] [--height=<h>] [--frames=<n>] [--fps=<f>] [--cones=<n>]" << std::endl;
+        std::cerr << "         [--cone-scale=<s>] [--noise=<sd>] [--curve=<c>] [--hue-shift=<h>] [--saturation-scale=<s>] [--value-shift=<v>]" << std::endl;
+        std::cerr << "         [--seed=<n>] [--bitrate=<bps>] [--idr-interval=<frames>]" << std::endl;
+        std::cerr << "         --width, --height:   frame size, both even (default 640x480)" << std::endl;
+        std::cerr << "         --frames, --fps:     length and frame rate of the recording (default 300 frames at 20 fps)" << std::endl;
+        std::cerr << "         --cones:             total number of cones per frame (default 6)" << std::endl;
+        std::cerr << "         --cone-scale:        cone size relative to the default size (default 1)" << std::endl;
+        std::cerr << "         --noise:             standard deviation of the pixel noise (default 0)" << std::endl;
+        std::cerr << "         --curve:             largest sideways bend of the track, it swings between -c and c (default 0.1)" << std::endl;
+        std::cerr << "         --hue-shift, --saturation-scale, --value-shift: lighting change in HSV space (default 0, 1, 0)" << std::endl;
+        std::cerr << "         --seed:              seed of the first frame, every frame adds its index (default 42)" << std::endl;
+        std::cerr << "         --bitrate:           target bitrate of the encoder (default 0.1 bit per pixel and frame)" << std::endl;
+        std::cerr << "         --idr-interval:      frames between IDR frames, so compact-recording can cut the output (default fps)" << std::endl;
+        std::cerr << "The ground truth is the steering of the drawn cone centroids, so it measures the detection alone." << std::endl;
+        std::cerr << "Example: " << argv[0] << " --out=synthetic-4k.rec --width=3840 --height=2160 --cones=12 --noise=8" << std::endl;
+        return 1;
+    }
+
+    SyntheticScene scene = defaultSyntheticScene(static_cast<int>(option(commandlineArguments, "width", 640)),
+                                                 static_cast<int>(option(commandlineArguments, "height", 480)));
+    scene.coneCount = static_cast<int>(option(commandlineArguments, "cones", 6));
+    scene.coneScale = option(commandlineArguments, "cone-scale", 1.0);
+    scene.noise = option(commandlineArguments, "noise", 0.0);
+    scene.hueShift = option(commandlineArguments, "hue-shift", 0.0);
+    scene.saturationScale = option(commandlineArguments, "saturation-scale", 1.0);
+    scene.valueShift = option(commandlineArguments, "value-shift", 0.0);
+    const uint64_t seed = static_cast<uint64_t>(option(commandlineArguments, "seed", 42));
+    const double curve = option(commandlineArguments, "curve", 0.1);
+    const int frames = static_cast<int>(option(commandlineArguments, "frames", 300));
+    const double fps = option(commandlineArguments, "fps", 20.0);
+    const int idrInterval = static_cast<int>(option(commandlineArguments, "idr-interval", fps));
+    const int bitrate = static_cast<int>(option(commandlineArguments, "bitrate", 0.1 * scene.width * scene.height * fps));
+    if (scene.width <= 0 || scene.height <= 0 || scene.width % 2 != 0 || scene.height % 2 != 0 || frames <= 0 || fps <= 0)
+    {
+        std::cerr << "Error: The frame size must be positive and even, frames and fps must be positive" << std::endl;
+        return 1;
+    }
+
+    std::ofstream out(commandlineArguments["out"], std::ios::binary);
+    if (!out.is_open())
+    {
+        std::cerr << "Error: Could not open output recording " << commandlineArguments["out"] << std::endl;
+        return 1;
+    }
+
+    ISVCEncoder *encoder = nullptr;
+    if (0 != WelsCreateSVCEncoder(&encoder) || nullptr == encoder)
+    {
+        std::cerr << "Error: Could not create H264 encoder" << std::endl;
+        return 1;
+    }
+    SEncParamBase parameters;
+    std::memset(&parameters, 0, sizeof(parameters));
+    parameters.iUsageType = CAMERA_VIDEO_REAL_TIME;
+    parameters.iPicWidth = scene.width;
+    parameters.iPicHeight = scene.height;
+    parameters.iTargetBitrate = bitrate;
+    parameters.iRCMode = RC_BITRATE_MODE;
+    parameters.fMaxFrameRate = static_cast<float>(fps);
+    if (cmResultSuccess != encoder->Initialize(&parameters))
+    {
+        std::cerr << "Error: Could not initialize H264 encoder" << std::endl;
+        WelsDestroySVCEncoder(encoder);
+        return 1;
+    }
+
+    const int lumaSize = scene.width * scene.height;
+    std::vector<uint8_t> i420(static_cast<size_t>(lumaSize * 3 / 2));
+    SSourcePicture picture;
+    std::memset(&picture, 0, sizeof(picture));
+    picture.iColorFormat = videoFormatI420;
+    picture.iPicWidth = scene.width;
+    picture.iPicHeight = scene.height;
+    picture.iStride[0] = scene.width;
+    picture.iStride[1] = picture.iStride[2] = scene.width / 2;
+    picture.pData[0] = i420.data();
+    picture.pData[1] = i420.data() + lumaSize;
+    picture.pData[2] = i420.data() + lumaSize + lumaSize / 4;
+
+    const SteeringConfig config = defaultSteeringConfig();
+    SteeringState state = initialSteeringState();
+    uint64_t bytesWritten = 0;
+    int framesWritten = 0;
+    for (int i = 0; i < frames; i++)
+    {
+        const int64_t sampleTimeUs = START_US + static_cast<int64_t>(std::llround(i * 1e6 / fps));
+        // Swing the track from left to right and back over ten seconds so that the steering varies
+        scene.curve = curve * std::sin(2.0 * M_PI * i / (10.0 * fps));
+        scene.seed = seed + static_cast<uint64_t>(i);
+        std::vector<cv::Point> blueCones, yellowCones;
+        const cv::Mat frame = renderConeScene(scene, blueCones, yellowCones);
+        const float groundSteering = static_cast<float>(steerFromCentroids(frame.size(), blueCones, yellowCones, config, state, nullptr));
+
+        // libyuv's RGB24 has the byte order of OpenCV's BGR
+        libyuv::RGB24ToI420(frame.data, static_cast<int>(frame.step), picture.pData[0], picture.iStride[0],
+                            picture.pData[1], picture.iStride[1], picture.pData[2], picture.iStride[2], scene.width, scene.height);
+        picture.uiTimeStamp = (sampleTimeUs - START_US) / 1000;
+        if (idrInterval > 0 && i % idrInterval == 0)
+        {
+            encoder->ForceIntraFrame(true);
+        }
+        SFrameBSInfo info;
+        std::memset(&info, 0, sizeof(info));
+        if (cmResultSuccess != encoder->EncodeFrame(&picture, &info))
+        {
+            std::cerr << "Error: Could not encode frame " << i << std::endl;
+            break;
+        }
+        if (info.eFrameType == videoFrameTypeSkip)
+        {
+            continue;
+        }
+        std::string data;
+        for (int layer = 0; layer < info.iLayerNum; layer++)
+        {
+            const SLayerBSInfo &layerInfo = info.sLayerInfo[layer];
+            int layerSize = 0;
+            for (int nal = 0; nal < layerInfo.iNalCount; nal++)
+            {
+                layerSize += layerInfo.pNalLengthInByte[nal];
+            }
+            data.append(reinterpret_cast<const char *>(layerInfo.pBsBuf), static_cast<size_t>(layerSize));
+        }
+
+        // Ground truth first, the replay pairs it with the frame of the same sample time
+        opendlv::proxy::GroundSteeringRequest steering;
+        steering.groundSteering(groundSteering);
+        writeEnvelope(out, steering, sampleTimeUs);
+        opendlv::proxy::ImageReading image;
+        image.fourcc("h264").width(static_cast<uint32_t>(scene.width)).height(static_cast<uint32_t>(scene.height)).data(data);
+        writeEnvelope(out, image, sampleTimeUs);
+        bytesWritten += data.size();
+        framesWritten++;
+    }
+    encoder->Uninitialize();
+    WelsDestroySVCEncoder(encoder);
+
+    out.close();
+    if (!out)
+    {
+        std::cerr << "Error: Could not write the output recording" << std::endl;
+        return 1;
+    }
+    std::cout << "Wrote " << framesWritten << " frames of " << scene.width << "x" << scene.height << " ("
+              << bytesWritten << " bytes of H264) to " << commandlineArguments["out"] << std::endl;
+    return 0;
+}
@@ -0,0 +1,156 @@
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+#include "join.hpp"
+
+#include <vector>
+
+namespace
+{
+    std::vector<FrameMatch> drain(FrameJoiner &joiner)
+    {
+        std::vector<FrameMatch> matches;
+        FrameMatch match{0, 0, false, 0, 0};
+        while (joiner.next(match))
+        {
+            matches.push_back(match);
+        }
+        return matches;
+    }
+}
+
+TEST_CASE("Interleaved frames and ground truth are matched with the nearest sample", "[join]")
+{
+    FrameJoiner joiner(5000);
+    joiner.advanceTo(0);
+    joiner.addGroundTruth(0, 0.0f);
+    joiner.addFrame(0, 4000);
+    joiner.advanceTo(10000);
+    joiner.addGroundTruth(10000, 0.1f);
+    joiner.addFrame(1, 16000);
+    joiner.advanceTo(20000);
+    joiner.addGroundTruth(20000, 0.2f);
+    joiner.addFrame(2, 29000);
+    joiner.advanceTo(30000);
+    joiner.addGroundTruth(30000, 0.3f);
+    joiner.finish();
+
+    const std::vector<FrameMatch> matches = drain(joiner);
+    REQUIRE(matches.size() == 3);
+    REQUIRE(matches[0].frameId == 0);
+    REQUIRE(matches[0].matched);
+    REQUIRE(matches[0].groundTruthTimeUs == 0);
+    REQUIRE(matches[1].groundTruthTimeUs == 20000);
+    REQUIRE(matches[2].groundTruthTimeUs == 30000);
+    REQUIRE(matches[2].groundTruth == Approx(0.3f));
+    REQUIRE(joiner.frames() == 3);
+    REQUIRE(joiner.matched() == 3);
+    REQUIRE(joiner.dropped() == 0);
+}
+
+TEST_CASE("A nearer ground truth that arrives out of order before the watermark passes it wins", "[join]")
+{
+    FrameJoiner joiner(50000);
+    joiner.addFrame(0, 100000);
+    joiner.addGroundTruth(130000, 0.5f);
+    joiner.advanceTo(101000);
+    // The sample at 130 ms is known, but one between the frame and it can still arrive
+    FrameMatch match{0, 0, false, 0, 0};
+    REQUIRE_FALSE(joiner.next(match));
+
+    joiner.addGroundTruth(105000, 0.2f);
+    joiner.advanceTo(130000);
+    REQUIRE(joiner.next(match));
+    REQUIRE(match.matched);
+    REQUIRE(match.groundTruthTimeUs == 105000);
+    REQUIRE(match.groundTruth == Approx(0.2f));
+    REQUIRE(joiner.matched() == 1);
+    REQUIRE(joiner.dropped() == 0);
+}
+
+TEST_CASE("Ground truth that arrives before its frames is matched once the frames arrive", "[join]")
+{
+    FrameJoiner joiner(10000);
+    joiner.addGroundTruth(50000, 0.5f);
+    joiner.addGroundTruth(10000, 0.1f);
+    joiner.addGroundTruth(30000, 0.3f);
+    joiner.addFrame(0, 12000);
+    joiner.addFrame(1, 33000);
+    joiner.addFrame(2, 70000);
+    joiner.finish();
+
+    const std::vector<FrameMatch> matches = drain(joiner);
+    REQUIRE(matches.size() == 3);
+    REQUIRE(matches[0].groundTruthTimeUs == 10000);
+    REQUIRE(matches[1].groundTruthTimeUs == 30000);
+    REQUIRE_FALSE(matches[2].matched);
+    REQUIRE(joiner.matched() == 2);
+    REQUIRE(joiner.dropped() == 1);
+}
+
+TEST_CASE("A frame without ground truth within the tolerance is dropped once the watermark passes it", "[join]")
+{
+    FrameJoiner joiner(5000);
+    joiner.addGroundTruth(0, 0.0f);
+    joiner.addFrame(0, 20000);
+    joiner.advanceTo(25000);
+    FrameMatch match{0, 0, false, 0, 0};
+    // A sample at exactly 25 ms would still be within the tolerance
+    REQUIRE_FALSE(joiner.next(match));
+
+    joiner.advanceTo(25001);
+    REQUIRE(joiner.next(match));
+    REQUIRE_FALSE(match.matched);
+    REQUIRE(joiner.dropped() == 1);
+}
+
+TEST_CASE("On a tie the earlier ground truth wins and frames keep their order", "[join]")
+{
+    FrameJoiner joiner(10000);
+    joiner.addFrame(0, 20000);
+    joiner.addFrame(1, 21000);
+    joiner.addGroundTruth(25000, 0.25f);
+    joiner.addGroundTruth(15000, 0.15f);
+    joiner.advanceTo(30000);
+
+    const std::vector<FrameMatch> matches = drain(joiner);
+    REQUIRE(matches.size() == 2);
+    REQUIRE(matches[0].frameId == 0);
+    REQUIRE(matches[0].groundTruthTimeUs == 15000);
+    REQUIRE(matches[1].frameId == 1);
+    REQUIRE(matches[1].groundTruthTimeUs == 25000);
+}
+
+TEST_CASE("Reset forgets pending frames and the counts", "[join]")
+{
+    FrameJoiner joiner(10000);
+    joiner.addFrame(0, 20000);
+    joiner.addGroundTruth(21000, 0.2f);
+    joiner.finish();
+    REQUIRE(joiner.matched() == 1);
+
+    joiner.reset();
+    REQUIRE(joiner.frames() == 0);
+    REQUIRE(joiner.matched() == 0);
+    FrameMatch match{0, 0, false, 0, 0};
+    REQUIRE_FALSE(joiner.next(match));
+
+    joiner.addFrame(0, 20000);
+    joiner.finish();
+    REQUIRE(joiner.dropped() == 1);
+}
+
+TEST_CASE("nearestSample picks the nearest sample within the tolerance", "[join]")
+{
+    struct Sample
+    {
+        int64_t timeUs;
+    };
+    const std::vector<Sample> samples = {{10000}, {20000}, {30000}};
+    REQUIRE(nearestSample(samples.begin(), samples.end(), 14000, 5000)->timeUs == 10000);
+    REQUIRE(nearestSample(samples.begin(), samples.end(), 16000, 5000)->timeUs == 20000);
+    REQUIRE(nearestSample(samples.begin(), samples.end(), 15000, 5000)->timeUs == 10000);
+    REQUIRE(nearestSample(samples.begin(), samples.end(), 30000, 0)->timeUs == 30000);
+    REQUIRE(nearestSample(samples.begin(), samples.end(), 36000, 5000) == samples.end());
+    REQUIRE(nearestSample(samples.begin(), samples.end(), 0, 5000) == samples.end());
+    REQUIRE(nearestSample(samples.end(), samples.end(), 0, 5000) == samples.end());
+}
@@ -0,0 +1,177 @@
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+#include "downsample.hpp"
+#include "results.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+    // Result file with groundTruth, steering and frame_ms columns, one row per timestamp
+    void writeResults(const std::string &path, const std::vector<int64_t> &timestamps, double steeringOffset)
+    {
+        ResultWriter writer(path, {"groundTruth", "steering", "frame_ms"});
+        REQUIRE(writer.isOpen());
+        for (int64_t timestamp : timestamps)
+        {
+            const double truth = std::sin(timestamp / 1e5);
+            const double values[3] = {truth, truth + steeringOffset, 10.0};
+            writer.append(timestamp, values);
+        }
+        writer.close();
+    }
+
+    std::vector<std::string> readLines(const std::string &path)
+    {
+        std::ifstream file(path);
+        std::vector<std::string> lines;
+        std::string line;
+        while (std::getline(file, line))
+        {
+            lines.push_back(line);
+        }
+        return lines;
+    }
+}
+
+TEST_CASE("Result files survive a round trip over several blocks", "[results]")
+{
+    const std::string path = "test-results-roundtrip.bin";
+    const size_t rows = 10000;
+    {
+        ResultWriter writer(path, {"groundTruth", "steering"});
+        REQUIRE(writer.isOpen());
+        for (size_t i = 0; i < rows; i++)
+        {
+            const double values[2] = {0.5 * i, -0.25 * i};
+            writer.append(static_cast<int64_t>(i * 33333), values);
+        }
+    }
+
+    ResultReader reader(path);
+    REQUIRE(reader.isOpen());
+    REQUIRE(reader.columns() == std::vector<std::string>{"groundTruth", "steering"});
+    REQUIRE(reader.columnIndex("steering") == 1);
+    REQUIRE(reader.columnIndex("frame_ms") == -1);
+    int64_t timestamp = 0;
+    std::vector<double> values;
+    size_t read = 0;
+    while (reader.next(timestamp, values))
+    {
+        REQUIRE(timestamp == static_cast<int64_t>(read * 33333));
+        REQUIRE(values.size() == 2);
+        REQUIRE(values[0] == Approx(0.5 * read));
+        REQUIRE(values[1] == Approx(-0.25 * read));
+        read++;
+    }
+    REQUIRE(read == rows);
+    std::remove(path.c_str());
+}
+
+TEST_CASE("A file that is not a result file is rejected", "[results]")
+{
+    const std::string path = "test-results-invalid.bin";
+    {
+        std::ofstream file(path);
+        file << "timestamp,groundTruth\n";
+    }
+    ResultReader reader(path);
+    REQUIRE_FALSE(reader.isOpen());
+    std::remove(path.c_str());
+}
+
+TEST_CASE("Rows are joined when their timestamps are within the tolerance", "[results]")
+{
+    const std::string current = "test-results-current.bin";
+    const std::string previous = "test-results-previous.bin";
+    writeResults(current, {0, 1000, 2000, 3500, 10000}, 0.0);
+    writeResults(previous, {50, 1040, 2100, 9000}, 0.1);
+
+    std::vector<std::pair<int64_t, double>> pairs;
+    JoinCounts counts{0, 0, 0};
+    REQUIRE(joinResults(current, previous, 100, [&](int64_t timestamp, const std::vector<double> &, const std::vector<double> &previousRow)
+                        { pairs.push_back(std::make_pair(timestamp, previousRow[1] - previousRow[0])); },
+                        counts));
+    REQUIRE(counts.matched == 3);
+    REQUIRE(counts.onlyCurrent == 2);
+    REQUIRE(counts.onlyPrevious == 1);
+    REQUIRE(pairs.size() == 3);
+    REQUIRE(pairs[0].first == 0);
+    REQUIRE(pairs[2].first == 2000);
+    REQUIRE(pairs[2].second == Approx(0.1));
+
+    REQUIRE(joinResults(current, previous, 0, [](int64_t, const std::vector<double> &, const std::vector<double> &) {}, counts));
+    REQUIRE(counts.matched == 0);
+    REQUIRE(counts.onlyCurrent == 5);
+    REQUIRE(counts.onlyPrevious == 4);
+
+    REQUIRE_FALSE(joinResults(current, "test-results-missing.bin", 0, [](int64_t, const std::vector<double> &, const std::vector<double> &) {}, counts));
+    std::remove(current.c_str());
+    std::remove(previous.c_str());
+}
+
+TEST_CASE("The joined series is downsampled like downsampleLttb", "[results]")
+{
+    const std::string current = "test-results-current.bin";
+    const std::string previous = "test-results-previous.bin";
+    const std::string joined = "test-results-joined.csv";
+    std::vector<int64_t> timestamps;
+    for (int64_t i = 0; i < 5000; i++)
+    {
+        timestamps.push_back(i * 33333);
+    }
+    writeResults(current, timestamps, 0.0);
+    writeResults(previous, timestamps, 0.05);
+
+    std::ostringstream out;
+    REQUIRE(compareResults(out, current, previous, 0, 0.09, joined, 100));
+    REQUIRE(out.str().find("Matched rows:        5000 (only current 0, only previous 0)") != std::string::npos);
+
+    std::vector<double> x;
+    std::vector<std::vector<double>> series(3);
+    for (int64_t timestamp : timestamps)
+    {
+        const double truth = std::sin(timestamp / 1e5);
+        x.push_back(static_cast<double>(timestamp));
+        series[0].push_back(truth);
+        series[1].push_back(truth);
+        series[2].push_back(truth + 0.05);
+    }
+    const std::vector<size_t> expected = downsampleLttb(x, series, 100);
+    const std::vector<std::string> lines = readLines(joined);
+    REQUIRE(lines.size() == expected.size() + 1);
+    REQUIRE(lines[0] == "timestamp,groundTruth,groundSteering,prevGroundSteering");
+    for (size_t i = 0; i < expected.size(); i++)
+    {
+        REQUIRE(lines[i + 1].substr(0, lines[i + 1].find(',')) == std::to_string(timestamps[expected[i]]));
+    }
+    std::remove(current.c_str());
+    std::remove(previous.c_str());
+    std::remove(joined.c_str());
+}
+
+TEST_CASE("Downsampling keeps at most the requested rows and the ends", "[downsample]")
+{
+    std::vector<double> x;
+    std::vector<std::vector<double>> series(1);
+    for (int i = 0; i < 1000; i++)
+    {
+        x.push_back(i);
+        series[0].push_back((i == 500) ? 10.0 : 0.0);
+    }
+    const std::vector<size_t> rows = downsampleLttb(x, series, 20);
+    REQUIRE(rows.size() == 20);
+    REQUIRE(rows.front() == 0);
+    REQUIRE(rows.back() == 999);
+    // The peak survives
+    REQUIRE(std::find(rows.begin(), rows.end(), 500) != rows.end());
+
+    REQUIRE(downsampleLttb(x, series, 0).size() == 1000);
+    REQUIRE(downsampleLttb(x, series, 2000).size() == 1000);
+    REQUIRE(downsampleLttb(x, series, 2) == std::vector<size_t>{0, 999});
+    REQUIRE(downsampleLttb(x, series, 1) == std::vector<size_t>{0});
+}
@@ -0,0 +1,107 @@
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+#include "timing.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+    typedef std::map<std::string, std::vector<double>> Summary;
+
+    bool gate(const Summary &baseline, const Summary &current, double maxSlowdownPercent)
+    {
+        std::ostringstream out;
+        return compareTimingSummaries(out, baseline, current, maxSlowdownPercent, 0.05);
+    }
+}
+
+TEST_CASE("welchPValue matches the t distribution", "[timing]")
+{
+    // t = 2 with 8 degrees of freedom, P(T > 2) = 0.0403
+    const std::vector<double> baseline = {10, 11, 12, 13, 14};
+    const std::vector<double> current = {12, 13, 14, 15, 16};
+    REQUIRE(welchPValue(baseline, current) == Approx(0.0403).margin(0.0005));
+    REQUIRE(welchPValue(current, baseline) == Approx(0.9597).margin(0.0005));
+    REQUIRE(welchPValue(baseline, baseline) == Approx(0.5));
+}
+
+TEST_CASE("welchPValue without noise only looks at the means", "[timing]")
+{
+    REQUIRE(welchPValue({10}, {11}) == Approx(0.0));
+    REQUIRE(welchPValue({10}, {9}) == Approx(1.0));
+    REQUIRE(welchPValue({10, 10}, {10.5, 10.5}) == Approx(0.0));
+}
+
+TEST_CASE("A significant slowdown beyond the allowed percentage fails the gate", "[timing]")
+{
+    const Summary baseline = {{"frame_ms", {10.0, 10.1, 9.9, 10.05, 9.95}}, {"fps", {30, 30, 30, 30, 30}}};
+    const Summary current = {{"frame_ms", {12.0, 12.1, 11.9, 12.05, 11.95}}, {"fps", {30, 30, 30, 30, 30}}};
+    REQUIRE_FALSE(gate(baseline, current, 10));
+    REQUIRE(gate(baseline, current, 25));
+}
+
+TEST_CASE("A slowdown that is not significantly beyond the allowed percentage passes", "[timing]")
+{
+    // 6% slower, but only one standard error beyond the 5% allowed
+    const Summary baseline = {{"frame_ms", {10.0, 10.2, 9.8, 10.1, 9.9}}, {"fps", {30, 30, 30, 30, 30}}};
+    const Summary current = {{"frame_ms", {10.6, 10.8, 10.4, 10.7, 10.5}}, {"fps", {30, 30, 30, 30, 30}}};
+    REQUIRE(gate(baseline, current, 5));
+}
+
+TEST_CASE("Frames per second are gated as milliseconds per frame", "[timing]")
+{
+    const Summary baseline = {{"frame_ms", {10, 10}}, {"fps", {100, 101, 99, 100}}};
+    const Summary slower = {{"frame_ms", {10, 10}}, {"fps", {50, 51, 49, 50}}};
+    const Summary faster = {{"frame_ms", {10, 10}}, {"fps", {200, 201, 199, 200}}};
+    REQUIRE_FALSE(gate(baseline, slower, 10));
+    REQUIRE(gate(baseline, faster, 10));
+}
+
+TEST_CASE("Stage timings never fail the gate", "[timing]")
+{
+    const Summary baseline = {{"frame_ms", {10, 10}}, {"fps", {30, 30}}, {"hsv_ms", {1, 1}}};
+    const Summary current = {{"frame_ms", {10, 10}}, {"fps", {30, 30}}, {"hsv_ms", {5, 5}}};
+    REQUIRE(gate(baseline, current, 10));
+}
+
+TEST_CASE("A gated metric missing from the baseline fails the gate", "[timing]")
+{
+    const Summary truncated = {{"fps", {30, 30}}};
+    const Summary current = {{"frame_ms", {10, 10}}, {"fps", {30, 30}}};
+    REQUIRE_FALSE(gate(truncated, current, 10));
+    REQUIRE_FALSE(gate(current, truncated, 10));
+}
+
+TEST_CASE("The gate leaves the stream formatting alone", "[timing]")
+{
+    const Summary summary = {{"frame_ms", {10, 10}}, {"fps", {30, 30}}};
+    std::ostringstream out;
+    const std::streamsize precision = out.precision();
+    compareTimingSummaries(out, summary, summary, 10, 0.05);
+    printTimingSummary(out, summary);
+    REQUIRE(out.precision() == precision);
+    REQUIRE((out.flags() & std::ios::fixed) == 0);
+}
+
+TEST_CASE("Timing summaries survive a round trip and malformed ones are rejected", "[timing]")
+{
+    const std::string path = "test-timing-summary.csv";
+    const Summary summary = {{"frame_ms", {10.5, 11.25}}, {"fps", {30, 29.5}}};
+    REQUIRE(writeTimingSummary(path, summary));
+    Summary read;
+    REQUIRE(readTimingSummary(path, read));
+    REQUIRE(read == summary);
+
+    for (const char *row : {"frame_ms,0,fast", "frame_ms,0,1.5ms", "frame_ms,0"})
+    {
+        {
+            std::ofstream file(path);
+            file << "metric,repetition,value\n" << row << "\n";
+        }
+        Summary malformed;
+        REQUIRE_FALSE(readTimingSummary(path, malformed));
+    }
+    std::remove(path.c_str());
+}
@@ -0,0 +1,297 @@
+#include "timing.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+    double mean(const std::vector<double> &values)
+    {
+        double sum = 0;
+        for (double v : values)
+        {
+            sum += v;
+        }
+        return values.empty() ? 0 : sum / values.size();
+    }
+
+    // Sample variance, 0 for fewer than two values
+    double variance(const std::vector<double> &values)
+    {
+        if (values.size() < 2)
+        {
+            return 0;
+        }
+        double m = mean(values);
+        double sum = 0;
+        for (double v : values)
+        {
+            sum += (v - m) * (v - m);
+        }
+        return sum / (values.size() - 1);
+    }
+
+    // Value below which the given fraction of the values lie, values get sorted
+    double percentile(std::vector<double> &values, double fraction)
+    {
+        if (values.empty())
+        {
+            return 0;
+        }
+        size_t index = static_cast<size_t>(fraction * (values.size() - 1) + 0.5);
+        std::nth_element(values.begin(), values.begin() + index, values.end());
+        return values[index];
+    }
+
+    // Continued fraction for the incomplete beta function (Numerical Recipes, betacf)
+    double betaContinuedFraction(double a, double b, double x)
+    {
+        const int MAX_ITERATIONS = 300;
+        const double EPSILON = 3e-14;
+        const double TINY = 1e-300;
+        double qab = a + b;
+        double qap = a + 1;
+        double qam = a - 1;
+        double c = 1;
+        double d = 1 - qab * x / qap;
+        if (std::fabs(d) < TINY)
+        {
+            d = TINY;
+        }
+        d = 1 / d;
+        double h = d;
+        for (int m = 1; m <= MAX_ITERATIONS; m++)
+        {
+            int m2 = 2 * m;
+            double aa = m * (b - m) * x / ((qam + m2) * (a + m2));
+            d = 1 + aa * d;
+            d = std::fabs(d) < TINY ? TINY : d;
+            c = 1 + aa / c;
+            c = std::fabs(c) < TINY ? TINY : c;
+            d = 1 / d;
+            h *= d * c;
+            aa = -(a + m) * (qab + m) * x / ((a + m2) * (qap + m2));
+            d = 1 + aa * d;
+            d = std::fabs(d) < TINY ? TINY : d;
+            c = 1 + aa / c;
+            c = std::fabs(c) < TINY ? TINY : c;
+            d = 1 / d;
+            double delta = d * c;
+            h *= delta;
+            if (std::fabs(delta - 1) < EPSILON)
+            {
+                break;
+            }
+        }
+        return h;
+    }
+
+    // Regularized incomplete beta function I_x(a, b)
+    double incompleteBeta(double a, double b, double x)
+    {
+        if (x <= 0)
+        {
+            return 0;
+        }
+        if (x >= 1)
+        {
+            return 1;
+        }
+        double front = std::exp(std::lgamma(a + b) - std::lgamma(a) - std::lgamma(b) +
+                                a * std::log(x) + b * std::log(1 - x));
+        if (x < (a + 1) / (a + b + 2))
+        {
+            return front * betaContinuedFraction(a, b, x) / a;
+        }
+        return 1 - front * betaContinuedFraction(b, a, 1 - x) / b;
+    }
+
+    // Turn a metric into a cost where larger is worse, frames per second become milliseconds per frame
+    std::vector<double> asCost(const std::string &name, const std::vector<double> &values)
+    {
+        std::vector<double> cost(values);
+        if (name == "fps")
+        {
+            for (double &v : cost)
+            {
+                v = v > 0 ? 1000.0 / v : 0;
+            }
+        }
+        return cost;
+    }
+}
+
+double welchPValue(const std::vector<double> &baseline, const std::vector<double> &current)
+{
+    double n1 = static_cast<double>(baseline.size());
+    double n2 = static_cast<double>(current.size());
+    double se1 = variance(baseline) / n1;
+    double se2 = variance(current) / n2;
+    double difference = mean(current) - mean(baseline);
+    if (n1 < 2 || n2 < 2 || se1 + se2 <= 0)
+    {
+        // Not enough repetitions to estimate the noise, any increase counts as significant
+        return difference > 0 ? 0 : 1;
+    }
+    double t = difference / std::sqrt(se1 + se2);
+    double df = (se1 + se2) * (se1 + se2) / (se1 * se1 / (n1 - 1) + se2 * se2 / (n2 - 1));
+    double tail = 0.5 * incompleteBeta(df / 2, 0.5, df / (df + t * t)); // P(T > |t|)
+    return t > 0 ? tail : 1 - tail;
+}
+
+TimingRecorder::TimingRecorder() : metrics_(), frameMs_(), stageSumMs_() {}
+
+void TimingRecorder::beginRepetition()
+{
+    frameMs_.clear();
+    std::fill(stageSumMs_, stageSumMs_ + STAGE_COUNT, 0.0);
+}
+
+void TimingRecorder::addFrame(const StageTimings &timings, double frameMs)
+{
+    frameMs_.push_back(frameMs);
+    for (int stage = 0; stage < STAGE_COUNT; stage++)
+    {
+        stageSumMs_[stage] += timings.ms[stage];
+    }
+}
+
+void TimingRecorder::endRepetition(double wallSeconds)
+{
+    double frames = static_cast<double>(frameMs_.size());
+    metrics_["fps"].push_back(wallSeconds > 0 ? frames / wallSeconds : 0);
+    metrics_["frame_ms"].push_back(mean(frameMs_));
+    metrics_["frame_p50_ms"].push_back(percentile(frameMs_, 0.50));
+    metrics_["frame_p95_ms"].push_back(percentile(frameMs_, 0.95));
+    metrics_["frame_max_ms"].push_back(frameMs_.empty() ? 0 : *std::max_element(frameMs_.begin(), frameMs_.end()));
+    for (int stage = 0; stage < STAGE_COUNT; stage++)
+    {
+        metrics_[std::string(STAGE_NAMES[stage]) + "_ms"].push_back(frames > 0 ? stageSumMs_[stage] / frames : 0);
+    }
+}
+
+bool writeTimingSummary(const std::string &path, const std::map<std::string, std::vector<double>> &metrics)
+{
+    std::ofstream file(path);
+    if (!file.is_open())
+    {
+        return false;
+    }
+    file << "metric,repetition,value\n";
+    file << std::setprecision(9);
+    for (const auto &metric : metrics)
+    {
+        for (size_t i = 0; i < metric.second.size(); i++)
+        {
+            file << metric.first << "," << i << "," << metric.second[i] << "\n";
+        }
+    }
+    return file.good();
+}
+
+bool readTimingSummary(const std::string &path, std::map<std::string, std::vector<double>> &metrics)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        return false;
+    }
+    std::string line;
+    std::getline(file, line); // Skip the header
+    while (std::getline(file, line))
+    {
+        if (line.empty())
+        {
+            continue;
+        }
+        std::istringstream row(line);
+        std::string name, repetition, value;
+        if (!std::getline(row, name, ',') || !std::getline(row, repetition, ',') || !std::getline(row, value))
+        {
+            return false;
+        }
+        try
+        {
+            size_t parsed = 0;
+            const double number = std::stod(value, &parsed);
+            if (parsed != value.size())
+            {
+                return false;
+            }
+            metrics[name].push_back(number);
+        }
+        catch (const std::exception &)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void printTimingSummary(std::ostream &out, const std::map<std::string, std::vector<double>> &metrics)
+{
+    const std::ios::fmtflags flags = out.flags();
+    const std::streamsize precision = out.precision();
+    for (const auto &metric : metrics)
+    {
+        out << std::left << std::setw(16) << metric.first << std::right << std::fixed << std::setprecision(3)
+            << std::setw(12) << mean(metric.second) << " +- " << std::sqrt(variance(metric.second))
+            << " (n=" << metric.second.size() << ")" << std::endl;
+    }
+    out.flags(flags);
+    out.precision(precision);
+}
+
+bool compareTimingSummaries(std::ostream &out,
+                            const std::map<std::string, std::vector<double>> &baseline,
+                            const std::map<std::string, std::vector<double>> &current,
+                            double maxSlowdownPercent, double alpha)
+{
+    const std::ios::fmtflags flags = out.flags();
+    const std::streamsize precision = out.precision();
+    // Stage timings are reported to help finding the cause, only the overall numbers can fail the run
+    const std::vector<std::string> gated = {"fps", "frame_ms"};
+    bool passed = true;
+    for (const std::string &name : gated)
+    {
+        auto base = baseline.find(name);
+        auto run = current.find(name);
+        if (base == baseline.end() || base->second.empty() || run == current.end() || run->second.empty())
+        {
+            out << std::left << std::setw(16) << name << std::right << " MISSING in the "
+                << ((base == baseline.end() || base->second.empty()) ? "baseline" : "current run") << std::endl;
+            passed = false;
+        }
+    }
+    for (const auto &metric : current)
+    {
+        auto base = baseline.find(metric.first);
+        if (base == baseline.end() || base->second.empty() || metric.second.empty())
+        {
+            continue;
+        }
+        std::vector<double> baseCost = asCost(metric.first, base->second);
+        std::vector<double> currentCost = asCost(metric.first, metric.second);
+        double baseMean = mean(baseCost);
+        double slowdown = baseMean > 0 ? (mean(currentCost) / baseMean - 1) * 100.0 : 0;
+        // Shift the baseline by the allowed slowdown, so the test asks whether the run is slower by more than that
+        for (double &cost : baseCost)
+        {
+            cost += baseMean * maxSlowdownPercent / 100.0;
+        }
+        double p = welchPValue(baseCost, currentCost);
+        bool isGated = std::find(gated.begin(), gated.end(), metric.first) != gated.end();
+        bool regressed = isGated && p < alpha;
+        out << std::left << std::setw(16) << metric.first << std::right << std::fixed << std::setprecision(3)
+            << std::setw(12) << mean(base->second) << " -> " << std::setw(12) << mean(metric.second)
+            << " slowdown " << std::setw(8) << std::setprecision(1) << slowdown << "% p=" << std::setprecision(4) << p
+            << (regressed ? "  REGRESSION" : "") << std::endl;
+        passed = passed && !regressed;
+    }
+    out.flags(flags);
+    out.precision(precision);
+    return passed;
+}
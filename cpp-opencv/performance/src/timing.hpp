@@ -0,0 +1,49 @@
+#ifndef TIMING_HPP
+#define TIMING_HPP
+
+#include "steering.hpp"
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Collects per-frame timings over several repetitions of a replay. Every metric ends up
+// with one value per repetition, which is what the regression test compares.
+class TimingRecorder
+{
+public:
+    TimingRecorder();
+
+    void beginRepetition();
+    void addFrame(const StageTimings &timings, double frameMs);
+    void endRepetition(double wallSeconds);
+
+    // Metric name -> one value per finished repetition
+    const std::map<std::string, std::vector<double>> &metrics() const { return metrics_; }
+
+private:
+    std::map<std::string, std::vector<double>> metrics_;
+    std::vector<double> frameMs_;
+    double stageSumMs_[STAGE_COUNT];
+};
+
+// Write/read a timing summary as CSV with the columns metric,repetition,value
+bool writeTimingSummary(const std::string &path, const std::map<std::string, std::vector<double>> &metrics);
+bool readTimingSummary(const std::string &path, std::map<std::string, std::vector<double>> &metrics);
+
+// Print mean and standard deviation of every metric
+void printTimingSummary(std::ostream &out, const std::map<std::string, std::vector<double>> &metrics);
+
+// One-sided p-value of Welch's t-test for "current has a larger mean than baseline". With fewer than
+// two values on a side or no variance, 0 if the mean of current is larger and 1 otherwise.
+double welchPValue(const std::vector<double> &baseline, const std::vector<double> &current);
+
+// Compare a run against a baseline with a one-sided Welch's t-test against the baseline shifted by
+// maxSlowdownPercent. Returns false if the frame latency or the frames per second got significantly
+// (p < alpha) worse by more than maxSlowdownPercent, or if either is missing from one of the summaries.
+bool compareTimingSummaries(std::ostream &out,
+                            const std::map<std::string, std::vector<double>> &baseline,
+                            const std::map<std::string, std::vector<double>> &current,
+                            double maxSlowdownPercent, double alpha);
+
+#endif
@@ -0,0 +1,121 @@
+#include "variants.hpp"
+#include "kernels.hpp"
+#include "perfcounters.hpp"
+#include <chrono>
+#include <sstream>
+
+namespace
+{
+    void runVariant(const cv::Mat &frame, Variant &variant, bool verbose)
+    {
+        TRACE_SCOPE("runVariant");
+        frame.copyTo(variant.frame);
+        // Counted on the thread that runs the variant
+        CountStages count(variant.counters);
+        auto start = std::chrono::steady_clock::now();
+        variant.steering = variant.sceneCache
+                               ? variant.sceneCache->process(variant.engine, variant.frame, verbose, variant.config, variant.state, &variant.timings)
+                               : variant.engine(variant.frame, verbose, variant.config, variant.state, &variant.timings);
+        variant.frameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+bool parseVariants(const std::string &spec, std::vector<Variant> &variants, std::string &error)
+{
+    std::istringstream list(spec);
+    std::string item;
+    while (std::getline(list, item, ','))
+    {
+        size_t colon = item.find(':');
+        const std::string engineName = item.substr(0, colon);
+        Variant variant{engineName, engineName, findSteeringEngine(engineName), defaultSteeringConfig(), "", initialSteeringState(),
+                        cv::Mat(), 0, 0, StageTimings(), nullptr, nullptr, 0, 0};
+        if (variant.engine == nullptr)
+        {
+            error = "unknown steering engine '" + engineName + "'";
+            return false;
+        }
+        if (colon != std::string::npos)
+        {
+            const std::string configPath = item.substr(colon + 1);
+            variant.configPath = configPath;
+            if (!loadSteeringConfig(configPath, variant.config))
+            {
+                error = "could not load steering config '" + configPath + "'";
+                return false;
+            }
+            // Label the variant after the config file name without directory and extension
+            std::string name = configPath.substr(configPath.find_last_of('/') + 1);
+            variant.label += "-" + name.substr(0, name.find_last_of('.'));
+        }
+        // Build the tables of the config once instead of in every frame
+        precomputeTables(variant.config);
+        for (const Variant &other : variants)
+        {
+            if (other.label == variant.label)
+            {
+                variant.label += "-" + std::to_string(variants.size());
+                break;
+            }
+        }
+        variants.push_back(variant);
+    }
+    if (variants.empty())
+    {
+        error = "no steering variant given";
+        return false;
+    }
+    return true;
+}
+
+void resetVariants(std::vector<Variant> &variants)
+{
+    for (Variant &variant : variants)
+    {
+        variant.state = initialSteeringState();
+        if (variant.sceneCache)
+        {
+            variant.sceneCache->reset();
+        }
+    }
+}
+
+void runVariants(const cv::Mat &frame, std::vector<Variant> &variants, bool verbose)
+{
+    if (verbose || variants.size() == 1)
+    {
+        for (Variant &variant : variants)
+        {
+            runVariant(frame, variant, verbose);
+        }
+        return;
+    }
+    cv::parallel_for_(cv::Range(0, static_cast<int>(variants.size())), [&frame, &variants](const cv::Range &range)
+                      {
+                          for (int i = range.start; i < range.end; i++)
+                          {
+                              runVariant(frame, variants[i], false);
+                          } });
+}
+
+void steerVariants(const cv::Size &frameSize, const std::vector<cv::Point> &blue, const std::vector<cv::Point> &yellow,
+                   std::vector<Variant> &variants)
+{
+    std::vector<cv::Point> blueCentroids, yellowCentroids;
+    for (Variant &variant : variants)
+    {
+        // steerFromCentroids sorts the centroids, every variant gets them in detection order
+        blueCentroids.assign(blue.begin(), blue.end());
+        yellowCentroids.assign(yellow.begin(), yellow.end());
+        auto start = std::chrono::steady_clock::now();
+        variant.steering = steerFromCentroids(frameSize, blueCentroids, yellowCentroids, variant.config, variant.state, nullptr);
+        variant.frameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        variant.timings = StageTimings();
+        variant.timings.ms[STAGE_STEERING] = variant.frameMs;
+    }
+}
+
+std::string variantColumn(const std::vector<Variant> &variants, size_t index, const std::string &column)
+{
+    return index == 0 ? column : variants[index].label + "." + column;
+}
@@ -0,0 +1,49 @@
+#ifndef VARIANTS_HPP
+#define VARIANTS_HPP
+
+#include "scenecache.hpp"
+#include "steering.hpp"
+#include <memory>
+#include <string>
+#include <vector>
+
+// One steering implementation evaluated on the decoded frames, together with its own
+// configuration, frame-to-frame state and the results for the current frame
+struct Variant
+{
+    std::string label;
+    std::string engineName;
+    SteeringEngine engine;
+    SteeringConfig config;
+    std::string configPath; // Config file the config was loaded from, empty for the default configuration
+    SteeringState state;
+    cv::Mat frame;        // Private copy of the decoded frame, engines draw on it
+    double steering;
+    double frameMs;
+    StageTimings timings;
+    StageCounters *counters; // Performance counters of every stage of the frame when profiling, otherwise nullptr
+    std::shared_ptr<SceneCache> sceneCache; // Reuses the detection on unchanged frames, nullptr processes every frame
+    int totalValid;       // Frames with a non-zero ground truth
+    int withinRange;      // Of those, frames within the accuracy threshold
+};
+
+// Parse a comma separated list of <engine>[:<config file>], e.g. "contour,contour:tuned.cfg".
+// Returns false and sets error if an engine is unknown or a config file cannot be loaded.
+bool parseVariants(const std::string &spec, std::vector<Variant> &variants, std::string &error);
+
+// Reset the frame-to-frame state of every variant, e.g. before replaying the recording again
+void resetVariants(std::vector<Variant> &variants);
+
+// Run every variant on its own copy of the frame, in parallel unless verbose (windows must stay on
+// the main thread). The frame is decoded once no matter how many variants there are.
+void runVariants(const cv::Mat &frame, std::vector<Variant> &variants, bool verbose);
+
+// Run only the steering math of every variant on previously detected cone centroids,
+// the steering stage timing is the only one that is set
+void steerVariants(const cv::Size &frameSize, const std::vector<cv::Point> &blue, const std::vector<cv::Point> &yellow,
+                   std::vector<Variant> &variants);
+
+// Column name of a variant, the first variant keeps the plain names for compatibility
+std::string variantColumn(const std::vector<Variant> &variants, size_t index, const std::string &column);
+
+#endif